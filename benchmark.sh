@@ -0,0 +1,75 @@
+#!/bin/bash
+
+# Validate commandline
+if [ $# -lt 2 ] ; then
+    echo -e "Invalid commandline.\nUsage: ./benchmark.sh <in-path> <timeout> [flags]"
+    echo -e "\t<in-path>: File to draw instances from."
+    echo -e "\t<timeout>: Integer number of seconds to wait for solver. Zero timeout means wait forever."
+    echo -e "\t[flags]: Extra flags for SatSudoku, such as --strategy=lookahead or --no-propagation."
+    echo -e "Compares the plain encoding against the --extended one."
+
+    exit -1
+fi
+
+# Validate in-path existence
+if [ ! -f $1 ] ; then
+    echo -e "Instances file doesn't exist.\nExiting.."
+    exit -1
+fi
+
+INPUT_PATH=$1
+TIMEOUT=$(($2))  # Whenever not an integer it leads to zero (wait forever)
+shift 2
+FLAGS=$@
+
+make -C `pwd`
+if [ $? -ne 0 ] ; then
+    echo "ERROR: Problem building project. Stopping";
+    exit -1
+fi
+
+# Same trick as orchestrate.sh to avoid word splitting inside a sudoku
+INSTANCES=`cat $INPUT_PATH | tr ' ' '*'`
+
+# Temporary files for benchmarking
+SUDOKU_BUFFER=`mktemp`
+SAT_BUFFER=`mktemp`
+STATS_BUFFER=`mktemp`
+
+# Extract a field from the json stats line
+stat_field() {
+    grep "^c stats" $STATS_BUFFER | sed -E "s/.*\"$1\":([0-9.e+-]+).*/\1/"
+}
+
+# Encode and solve current sudoku, printing clauses, propagations and solve time
+run_encoding() {
+    (./SatSudoku --toSAT $FLAGS $1 < $SUDOKU_BUFFER) > $SAT_BUFFER
+    CLAUSES=`grep "^p cnf" $SAT_BUFFER | cut -d ' ' -f 4`
+
+    (timeout --preserve-status -s SIGUSR1 "$TIMEOUT"s ./SatSudoku --solve --stats=json $FLAGS < $SAT_BUFFER) > /dev/null 2> $STATS_BUFFER
+    if [ $? -eq 42 ]; then
+        printf "%10s %14s %12s" "$CLAUSES" "-" "timeout"
+        return
+    fi
+
+    PROPAGATIONS=`stat_field propagations`
+    TIME=`grep -o "Elapsed time: [0-9.e+-]*" $STATS_BUFFER | cut -d ' ' -f 3`
+    printf "%10s %14s %12s" "$CLAUSES" "$PROPAGATIONS" "$TIME"
+}
+
+printf "%5s | %10s %14s %12s | %10s %14s %12s\n" "idx" "clauses" "propagations" "ms" "clauses" "propagations" "ms"
+printf "%5s | %38s | %38s\n" "" "plain" "extended"
+
+let "idx = -1"
+for sudoku in $INSTANCES; do
+    ((++idx))
+    echo $sudoku | tr '*' ' ' > "$SUDOKU_BUFFER"
+
+    printf "%5s | " "$idx"
+    run_encoding ""
+    printf " | "
+    run_encoding "--extended"
+    printf "\n"
+done
+
+rm $SUDOKU_BUFFER $SAT_BUFFER $STATS_BUFFER
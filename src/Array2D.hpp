@@ -33,8 +33,8 @@ class Array2D
         _elements[actual_index(i,j)] = element;
     }
 
-    size_t get_rows() { return _rows; }
-    size_t get_cols() { return _cols; }
+    size_t get_rows() const { return _rows; }
+    size_t get_cols() const { return _cols; }
 
     private:
     /// @brief Get actual index inside the stored vector corresponding to this row and column
@@ -0,0 +1,88 @@
+#ifndef BASE_CNF_HPP
+#define BASE_CNF_HPP
+
+#include <array>
+#include <cstddef>
+
+/// @brief Rule clauses of the dense sudoku encoding, where every cell and digit has variable (i * n^2 + j) * n^2 + d:
+/// every cell holds a digit, at most one, and no digit repeats in a row, column or region. They don't depend on
+/// givens, so for small orders they're generated at compile time as a flat list of literals, each clause ended by a 0
+class BaseCnf
+{
+    public:
+        /// @brief Generate rule clauses for a sudoku of order n
+        /// @param n order of the sudoku
+        /// @param emit called with each literal, and with 0 at the end of each clause
+        template <typename Emit>
+        static constexpr void generate(int n, Emit&& emit)
+        {
+            int const n2 = n * n;
+            auto const var = [n2](int i, int j, int d) { return (i * n2 + j) * n2 + d; };
+            auto const pair = [&emit](int var, int var_) { emit(-var); emit(-var_); emit(0); };
+
+            // Completeness
+            for (int i = 0; i < n2; i++)
+                for (int j = 0; j < n2; j++)
+                {
+                    for (int d = 1; d <= n2; d++)
+                        emit(var(i, j, d));
+                    emit(0);
+                }
+
+            // Uniqueness
+            for (int i = 0; i < n2; i++)
+                for (int j = 0; j < n2; j++)
+                    for (int d = 1; d <= n2; d++)
+                        for (int d_ = d + 1; d_ <= n2; d_++)
+                            pair(var(i, j, d), var(i, j, d_));
+
+            // Rows and columns
+            for (int i = 0; i < n2; i++)
+                for (int d = 1; d <= n2; d++)
+                    for (int j = 0; j < n2; j++)
+                        for (int j_ = j + 1; j_ < n2; j_++)
+                            pair(var(i, j, d), var(i, j_, d));
+
+            for (int j = 0; j < n2; j++)
+                for (int d = 1; d <= n2; d++)
+                    for (int i = 0; i < n2; i++)
+                        for (int i_ = i + 1; i_ < n2; i_++)
+                            pair(var(i, j, d), var(i_, j, d));
+
+            // Regions. Pairs in the same row or column were already added
+            for (int r = 0; r < n2; r++)
+                for (int d = 1; d <= n2; d++)
+                    for (int a = 0; a < n2; a++)
+                        for (int b = a + 1; b < n2; b++)
+                        {
+                            int const i = (r / n) * n + a / n, j = (r % n) * n + a % n;
+                            int const i_ = (r / n) * n + b / n, j_ = (r % n) * n + b % n;
+                            if (i != i_ && j != j_)
+                                pair(var(i, j, d), var(i_, j_, d));
+                        }
+        }
+
+        /// @brief Number of literals written by generate for order n, clause terminators included
+        static constexpr size_t n_literals(int n)
+        {
+            size_t count = 0;
+            generate(n, [&count](int) { count++; });
+            return count;
+        }
+
+        /// @brief Generate rule clauses for order N into an array, meant to be evaluated at compile time
+        template <int N>
+        static constexpr std::array<int, n_literals(N)> table()
+        {
+            std::array<int, n_literals(N)> literals{};
+            size_t next = 0;
+            generate(N, [&literals, &next](int literal) { literals[next++] = literal; });
+            return literals;
+        }
+};
+
+/// @brief Rule clauses for order N, baked into the binary
+template <int N>
+inline constexpr std::array<int, BaseCnf::n_literals(N)> base_cnf_table = BaseCnf::table<N>();
+
+#endif
@@ -0,0 +1,293 @@
+#include "BitboardSolver.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr uint16_t all_digits = 0x1FF;
+    /// Lanes of a row that hold cells, the rest are padding
+    constexpr uint32_t cell_lanes = 0x1FF;
+
+    /// @brief 16 lanes of 16 bits, enough for a row of candidate masks
+    struct Lanes
+    {
+#if defined(__AVX2__)
+        __m256i v;
+
+        static Lanes load(const uint16_t* p) { return {_mm256_load_si256(reinterpret_cast<const __m256i*>(p))}; }
+        void store(uint16_t* p) const { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+        static Lanes splat(uint16_t x) { return {_mm256_set1_epi16(static_cast<short>(x))}; }
+        friend Lanes operator&(Lanes a, Lanes b) { return {_mm256_and_si256(a.v, b.v)}; }
+        friend Lanes operator|(Lanes a, Lanes b) { return {_mm256_or_si256(a.v, b.v)}; }
+        friend Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_epi16(a.v, b.v)}; }
+        /// ~a & b
+        static Lanes andnot(Lanes a, Lanes b) { return {_mm256_andnot_si256(a.v, b.v)}; }
+        /// All ones in lanes where a and b are equal, zero elsewhere
+        static Lanes eq(Lanes a, Lanes b) { return {_mm256_cmpeq_epi16(a.v, b.v)}; }
+        /// Bit k is set when lane k is all ones
+        uint32_t mask() const
+        {
+            auto const packed = _mm_packs_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+            return static_cast<uint32_t>(_mm_movemask_epi8(packed));
+        }
+#elif defined(__SSE2__)
+        __m128i lo, hi;
+
+        static Lanes load(const uint16_t* p)
+        {
+            return {_mm_load_si128(reinterpret_cast<const __m128i*>(p)), _mm_load_si128(reinterpret_cast<const __m128i*>(p + 8))};
+        }
+        void store(uint16_t* p) const
+        {
+            _mm_store_si128(reinterpret_cast<__m128i*>(p), lo);
+            _mm_store_si128(reinterpret_cast<__m128i*>(p + 8), hi);
+        }
+        static Lanes splat(uint16_t x) { return {_mm_set1_epi16(static_cast<short>(x)), _mm_set1_epi16(static_cast<short>(x))}; }
+        friend Lanes operator&(Lanes a, Lanes b) { return {_mm_and_si128(a.lo, b.lo), _mm_and_si128(a.hi, b.hi)}; }
+        friend Lanes operator|(Lanes a, Lanes b) { return {_mm_or_si128(a.lo, b.lo), _mm_or_si128(a.hi, b.hi)}; }
+        friend Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_epi16(a.lo, b.lo), _mm_sub_epi16(a.hi, b.hi)}; }
+        static Lanes andnot(Lanes a, Lanes b) { return {_mm_andnot_si128(a.lo, b.lo), _mm_andnot_si128(a.hi, b.hi)}; }
+        static Lanes eq(Lanes a, Lanes b) { return {_mm_cmpeq_epi16(a.lo, b.lo), _mm_cmpeq_epi16(a.hi, b.hi)}; }
+        uint32_t mask() const { return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(lo, hi))); }
+#else
+        uint16_t l[16];
+
+        static Lanes load(const uint16_t* p) { Lanes r; for (int k = 0; k < 16; k++) r.l[k] = p[k]; return r; }
+        void store(uint16_t* p) const { for (int k = 0; k < 16; k++) p[k] = l[k]; }
+        static Lanes splat(uint16_t x) { Lanes r; for (int k = 0; k < 16; k++) r.l[k] = x; return r; }
+        friend Lanes operator&(Lanes a, Lanes b) { for (int k = 0; k < 16; k++) a.l[k] &= b.l[k]; return a; }
+        friend Lanes operator|(Lanes a, Lanes b) { for (int k = 0; k < 16; k++) a.l[k] |= b.l[k]; return a; }
+        friend Lanes operator-(Lanes a, Lanes b) { for (int k = 0; k < 16; k++) a.l[k] -= b.l[k]; return a; }
+        static Lanes andnot(Lanes a, Lanes b) { for (int k = 0; k < 16; k++) a.l[k] = ~a.l[k] & b.l[k]; return a; }
+        static Lanes eq(Lanes a, Lanes b) { for (int k = 0; k < 16; k++) a.l[k] = a.l[k] == b.l[k] ? 0xFFFF : 0; return a; }
+        uint32_t mask() const { uint32_t m = 0; for (int k = 0; k < 16; k++) m |= (l[k] == 0xFFFF ? 1u : 0u) << k; return m; }
+#endif
+    };
+
+    /// @brief Lanes of a row where x is not zero
+    inline uint32_t nonzero_lanes(Lanes x) { return ~Lanes::eq(x, Lanes::splat(0)).mask() & cell_lanes; }
+
+    /// @brief Spread a value per region of a band over the lanes of its cells
+    inline Lanes band_lanes(uint16_t const* regions)
+    {
+        alignas(32) uint16_t lanes[16] = {};
+        for (int c = 0; c < 9; c++)
+            lanes[c] = regions[c / 3];
+        return Lanes::load(lanes);
+    }
+}
+
+const char* BitboardSolver::instruction_set()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+bool BitboardSolver::propagate(Board& board)
+{
+    auto const zero = Lanes::splat(0), one = Lanes::splat(1), all = Lanes::splat(all_digits), ones = Lanes::splat(0xFFFF);
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        // Columns, vertically over rows: solved digits, and digits that fit in a single cell
+        Lanes rows[9], fixed[9];
+        Lanes col_used = zero, col_twice = zero, col_once = zero, col_more = zero;
+        for (int r = 0; r < 9; r++)
+        {
+            auto const x = Lanes::load(board.cells[r]);
+            // Lanes with a single candidate. Padding lanes also match, but they hold no digits
+            auto const f = Lanes::eq(x & (x - one), zero);
+            auto const solved = f & x;
+            col_twice = col_twice | (col_used & solved);
+            col_used = col_used | solved;
+            col_more = col_more | (col_once & x);
+            col_once = col_once | x;
+            rows[r] = x;
+            fixed[r] = f;
+        }
+        // A digit solved twice or with nowhere to go. An empty cell leaves some digit of its column without a place
+        if (nonzero_lanes(col_twice) || (~Lanes::eq(col_once, all).mask() & cell_lanes))
+            return false;
+        auto const col_hidden = Lanes::andnot(col_more, col_once);
+
+        // Rows and regions, the same in a single scalar pass. One band at a time, so region sums stay in registers
+        uint16_t row_used[9], row_hidden[9], box_used[9], box_hidden[9];
+        uint16_t clash = 0;
+        for (int band = 0; band < 3; band++)
+        {
+            uint16_t b_used[3] = {}, b_twice[3] = {}, b_once[3] = {}, b_more[3] = {};
+            for (int r = band * 3; r < band * 3 + 3; r++)
+            {
+                uint16_t used = 0, twice = 0, once = 0, more = 0;
+                for (int c = 0; c < 9; c++)
+                {
+                    auto const v = board.cells[r][c];
+                    auto const solved = static_cast<uint16_t>(v & (v - 1) ? 0 : v);
+                    twice |= used & solved;
+                    used |= solved;
+                    more |= once & v;
+                    once |= v;
+                    b_twice[c / 3] |= b_used[c / 3] & solved;
+                    b_used[c / 3] |= solved;
+                    b_more[c / 3] |= b_once[c / 3] & v;
+                    b_once[c / 3] |= v;
+                }
+                clash |= twice | (once ^ all_digits);
+                row_used[r] = used;
+                row_hidden[r] = once & ~more;
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                clash |= b_twice[k] | (b_once[k] ^ all_digits);
+                box_used[band * 3 + k] = b_used[k];
+                box_hidden[band * 3 + k] = b_once[k] & ~b_more[k];
+            }
+        }
+        if (clash)
+            return false;
+
+        Lanes band_used[3], band_hidden[3];
+        for (int band = 0; band < 3; band++)
+        {
+            band_used[band] = band_lanes(box_used + band * 3);
+            band_hidden[band] = band_lanes(box_hidden + band * 3);
+        }
+
+        for (int r = 0; r < 9; r++)
+        {
+            auto const x = rows[r];
+            // Solved cells keep their digit, the rest lose every digit solved in their row, column or region
+            auto const peers = col_used | Lanes::splat(row_used[r]) | band_used[r / 3];
+            auto y = (fixed[r] & x) | Lanes::andnot(fixed[r], Lanes::andnot(peers, x));
+
+            // Hidden singles. They were found before eliminating, which is fine: a digit with one place left
+            // among more candidates still has at most that place. A cell that must hold two digits is a dead end
+            auto const h = y & (col_hidden | Lanes::splat(row_hidden[r]) | band_hidden[r / 3]);
+            if (~Lanes::eq(h & (h - one), zero).mask() & cell_lanes)
+                return false;
+            auto const has_hidden = Lanes::andnot(Lanes::eq(h, zero), ones);
+            y = (has_hidden & h) | Lanes::andnot(has_hidden, y);
+
+            if (~Lanes::eq(x, y).mask() & cell_lanes)
+                changed = true;
+            y.store(board.cells[r]);
+        }
+    }
+
+    return true;
+}
+
+bool BitboardSolver::search(Board& board)
+{
+    if (!propagate(board))
+        return false;
+
+    int best_r = -1, best_c = -1, best_count = 10;
+    for (int r = 0; r < 9 && best_count > 2; r++)
+        for (int c = 0; c < 9; c++)
+        {
+            auto const count = __builtin_popcount(board.cells[r][c]);
+            if (count > 1 && count < best_count)
+            {
+                best_r = r;
+                best_c = c;
+                best_count = count;
+            }
+        }
+    if (best_r < 0)
+        return true;
+
+    for (unsigned int candidates = board.cells[best_r][best_c]; candidates != 0; candidates &= candidates - 1)
+    {
+        Board next = board;
+        next.cells[best_r][best_c] = static_cast<uint16_t>(candidates & -candidates);
+        _guesses++;
+        if (search(next))
+        {
+            board = next;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool BitboardSolver::solve(const Board81& puzzle, Board81& solution)
+{
+    Board board = {};
+    for (int c = 0; c < 81; c++)
+    {
+        auto const d = puzzle[c];
+        if (d > 9)
+            return false;
+        board.cells[c / 9][c % 9] = d == 0 ? all_digits : static_cast<uint16_t>(1u << (d - 1));
+    }
+
+    if (!search(board))
+        return false;
+
+    for (int c = 0; c < 81; c++)
+        solution[c] = static_cast<uint8_t>(__builtin_ctz(board.cells[c / 9][c % 9]) + 1);
+    return true;
+}
+
+size_t BitboardSolver::solve_batch(const std::vector<Board81>& puzzles, std::vector<Board81>& solutions, std::vector<bool>& solved)
+{
+    solutions.resize(puzzles.size());
+    solved.assign(puzzles.size(), false);
+    size_t n_solved = 0;
+    for (size_t p = 0; p < puzzles.size(); p++)
+    {
+        solved[p] = solve(puzzles[p], solutions[p]);
+        if (solved[p])
+            n_solved++;
+        else
+            solutions[p] = puzzles[p];
+    }
+
+    return n_solved;
+}
+
+SatSolution BitboardSolver::solve(Sudoku& sudoku)
+{
+    sudoku.build_variable_map();
+    auto const n_variables = sudoku.get_n_variables();
+    auto const unsatisfiable = SatSolution{SatSatisfiable::UNSATISFIABLE, 0, std::vector<Variable>(), SATFormat::CNF};
+    if (sudoku.get_order() != 3 || !sudoku.is_consistent())
+        return unsatisfiable;
+
+    auto const& board = sudoku.get_board();
+    Board81 puzzle, solution;
+    for (int c = 0; c < 81; c++)
+    {
+        auto const d = board.get(c / 9, c % 9);
+        if (d < 0 || d > 9)
+            return unsatisfiable;
+        puzzle[c] = static_cast<uint8_t>(d);
+    }
+
+    if (!solve(puzzle, solution))
+        return unsatisfiable;
+
+    std::vector<Variable> result(n_variables);
+    for (size_t i = 0; i < result.size(); i++)
+        result[i] = -static_cast<Variable>(i + 1);
+    for (int c = 0; c < 81; c++)
+        if (puzzle[c] == 0)
+            if (auto const variable = sudoku.cell_to_variable(c / 9, c % 9, solution[c]))
+                result[variable - 1] = variable;
+
+    return SatSolution{SatSatisfiable::SATISFIABLE, n_variables, result, SATFormat::CNF};
+}
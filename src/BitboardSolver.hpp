@@ -0,0 +1,63 @@
+#ifndef BITBOARD_SOLVER_HPP
+#define BITBOARD_SOLVER_HPP
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "SatSolver.hpp"
+#include "Sudoku.hpp"
+
+/// @brief Digits of an order 3 sudoku in row major order, 0 for empty cells
+using Board81 = std::array<uint8_t, 81>;
+
+/// @brief Solver specialized for order 3 sudokus. Candidates are 9 bit masks, one per cell, and a row of the
+/// board is a vector of 16 bit lanes, so eliminations by column and singles detection work on a whole row at a
+/// time: AVX2 when built with -mavx2, SSE2 otherwise on x86-64, and a plain loop everywhere else. Rows and
+/// regions are reduced with scalar code. Search picks the cell with fewest candidates and copies the board on
+/// each guess, which at 288 bytes is cheaper than undoing changes
+class BitboardSolver
+{
+    public:
+        /// @brief Solve a single sudoku
+        /// @param puzzle givens, 0 for empty cells
+        /// @param solution where to write the solution. Left untouched if there's none
+        /// @return true if a solution was found
+        bool solve(const Board81& puzzle, Board81& solution);
+
+        /// @brief Solve many sudokus back to back
+        /// @param puzzles givens of each sudoku
+        /// @param solutions resized to match puzzles. Unsolvable puzzles are copied as they are
+        /// @param solved resized to match puzzles, true where a solution was found
+        /// @return number of puzzles solved
+        size_t solve_batch(const std::vector<Board81>& puzzles, std::vector<Board81>& solutions, std::vector<bool>& solved);
+
+        /// @brief Solve an order 3 sudoku and return the solution over its variable map, like DlxSolver does
+        /// @param sudoku sudoku to solve, propagated or not. Its variable map is built
+        /// @return A solution ready for Sudoku::add_sat_solution, UNSATISFIABLE if there's none
+        SatSolution solve(Sudoku& sudoku);
+
+        /// @brief Get number of guesses made since this solver was created
+        size_t get_guesses() const { return _guesses; }
+
+        /// @brief Name of the vector instructions this solver was built with: "avx2", "sse2" or "scalar"
+        static const char* instruction_set();
+
+    private:
+        /// @brief Candidates of each cell, a row per vector. Lanes 9 to 15 are padding and stay at 0
+        struct Board
+        {
+            alignas(32) uint16_t cells[9][16];
+        };
+
+        /// @brief Remove candidates seen by solved cells and fill in naked and hidden singles until nothing changes
+        /// @return false if some cell or some digit of a unit ran out of options
+        static bool propagate(Board& board);
+
+        /// @brief Propagate, then guess on the cell with fewest candidates
+        /// @return true if board was completed. board holds the solution then
+        bool search(Board& board);
+
+    private:
+        size_t _guesses = 0;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "ClauseSink.hpp"
+#include <algorithm>
+
+void ClauseSink::add_clauses(const Variable* literals, size_t n_literals)
+{
+    Clause clause;
+    for (size_t i = 0; i < n_literals; i++)
+    {
+        if (literals[i] != 0)
+        {
+            clause.push_back(literals[i]);
+            continue;
+        }
+        add_clause(clause);
+        clause.clear();
+    }
+}
+
+void ClauseCounter::add_clauses(const Variable* literals, size_t n_literals)
+{
+    _n_clauses += std::count(literals, literals + n_literals, 0);
+}
+
+DimacsWriter::DimacsWriter(std::ostream& out, size_t n_variables, size_t n_clauses)
+    : _out(out)
+{
+    _out << "p cnf " << n_variables << " " << n_clauses << "\n";
+}
+
+void DimacsWriter::add_clause(const Clause& clause)
+{
+    for (auto const var : clause)
+        _out << var << " ";
+    _out << "0\n";
+}
+
+void DimacsWriter::add_clauses(const Variable* literals, size_t n_literals)
+{
+    for (size_t i = 0; i < n_literals; i++)
+    {
+        if (literals[i] != 0)
+            _out << literals[i] << " ";
+        else 
+            _out << "0\n";
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef CLAUSE_SINK_HPP
+#define CLAUSE_SINK_HPP
+
+#include <vector>
+#include <ostream>
+
+using Variable = int;
+using Clause = std::vector<Variable>;
+
+/// @brief Destination for clauses produced by an encoder, so they don't need to be stored before being used
+class ClauseSink
+{
+    public:
+        virtual ~ClauseSink() = default;
+
+        /// @brief Receive a new clause, in DIMACS format
+        /// @param clause clause to add, literals are p or -p
+        virtual void add_clause(const Clause& clause) = 0;
+
+        /// @brief Receive several clauses as a flat list of literals, each clause ended by a 0
+        /// @param literals first literal
+        /// @param n_literals number of literals, terminators included
+        virtual void add_clauses(const Variable* literals, size_t n_literals);
+};
+
+/// @brief Sink that only counts clauses, useful to write a DIMACS header before the clauses themselves
+class ClauseCounter : public ClauseSink
+{
+    public:
+        void add_clause(const Clause&) override { _n_clauses++; }
+
+        void add_clauses(const Variable* literals, size_t n_literals) override;
+
+        /// @brief Get number of clauses received so far
+        size_t get_n_clauses() const { return _n_clauses; }
+
+    private:
+        size_t _n_clauses = 0;
+};
+
+/// @brief Sink that keeps clauses in memory, in the order they arrive
+class ClauseBuffer : public ClauseSink
+{
+    public:
+        void add_clause(const Clause& clause) override { clauses.push_back(clause); }
+
+        std::vector<Clause> clauses;
+};
+
+/// @brief Sink that writes each clause to a stream in DIMACS cnf format as soon as it arrives
+class DimacsWriter : public ClauseSink
+{
+    public:
+        /// @brief Create a writer and write the DIMACS header, so numbers must be known beforehand
+        /// @param out stream to write to
+        /// @param n_variables number of variables in the formula
+        /// @param n_clauses number of clauses that will be written
+        DimacsWriter(std::ostream& out, size_t n_variables, size_t n_clauses);
+
+        void add_clause(const Clause& clause) override;
+
+        void add_clauses(const Variable* literals, size_t n_literals) override;
+
+    private:
+        std::ostream& _out;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "DlxSolver.hpp"
+
+DlxSolver::DlxSolver(Sudoku& sudoku)
+{
+    sudoku.build_variable_map();
+    _n_variables = sudoku.get_n_variables();
+    _consistent = sudoku.is_consistent();
+
+    auto const n = static_cast<int>(sudoku.get_order());
+    auto const n2 = n * n;
+    auto const n4 = n2 * n2;
+    auto const& board = sudoku.get_board();
+    auto const& candidates = sudoku.get_candidates();
+
+    // Constraints are cell, digit in row, digit in column and digit in region. Only unsatisfied ones 
+    // get a column, givens already cover the rest
+    std::vector<bool> needed(4 * n4, false);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            needed[i * n2 + j] = board.get(i, j) == 0;
+            for (int d = 1; d <= n2; d++)
+            {
+                needed[n4 + i * n2 + d - 1] = true;
+                needed[2 * n4 + j * n2 + d - 1] = true;
+                needed[3 * n4 + ((i / n) * n + j / n) * n2 + d - 1] = true;
+            }
+        }
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+            if (auto const d = board.get(i, j); d >= 1 && d <= n2)
+            {
+                needed[n4 + i * n2 + d - 1] = false;
+                needed[2 * n4 + j * n2 + d - 1] = false;
+                needed[3 * n4 + ((i / n) * n + j / n) * n2 + d - 1] = false;
+            }
+
+    // Root and column headers, linked in a circle
+    std::vector<int> column_of(4 * n4, 0);
+    _left.push_back(0); _right.push_back(0); _up.push_back(0); _down.push_back(0); _column.push_back(0);
+    _size.push_back(0); _variable.push_back(0);
+    for (int constraint = 0; constraint < 4 * n4; constraint++)
+    {
+        if (!needed[constraint])
+            continue;
+
+        int const header = static_cast<int>(_left.size());
+        column_of[constraint] = header;
+        _left.push_back(_left[0]); _right.push_back(0);
+        _right[_left[0]] = header; _left[0] = header;
+        _up.push_back(header); _down.push_back(header); _column.push_back(header);
+        _size.push_back(0); _variable.push_back(0);
+    }
+
+    // A row per candidate, with a node in each of its 4 columns linked horizontally
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const cell_candidates = board.get(i, j) == 0 ? candidates.get(i, j) : 0;
+            for (int d = 1; d <= n2; d++)
+            {
+                if (!((cell_candidates >> (d - 1)) & 1))
+                    continue;
+
+                auto const variable = sudoku.cell_to_variable(i, j, d);
+                int const constraints[] = {
+                    i * n2 + j, 
+                    n4 + i * n2 + d - 1, 
+                    2 * n4 + j * n2 + d - 1, 
+                    3 * n4 + ((i / n) * n + j / n) * n2 + d - 1
+                };
+
+                int first = -1;
+                for (auto const constraint : constraints)
+                {
+                    auto const node = add_node(column_of[constraint], variable);
+                    if (first < 0)
+                    {
+                        first = node;
+                        _left[node] = _right[node] = node;
+                        continue;
+                    }
+                    _left[node] = _left[first];
+                    _right[node] = first;
+                    _right[_left[first]] = node;
+                    _left[first] = node;
+                }
+            }
+        }
+}
+
+int DlxSolver::add_node(int column, Variable variable)
+{
+    int const node = static_cast<int>(_left.size());
+    _left.push_back(node); _right.push_back(node);
+    _up.push_back(_up[column]); _down.push_back(column);
+    _down[_up[column]] = node;
+    _up[column] = node;
+    _column.push_back(column);
+    _size.push_back(0);
+    _variable.push_back(variable);
+    _size[column]++;
+    return node;
+}
+
+SatSolution DlxSolver::solve()
+{
+    _nodes = 0;
+    _chosen.clear();
+    if (!_consistent || !search())
+        return SatSolution{SatSatisfiable::UNSATISFIABLE, 0, std::vector<Variable>(), SATFormat::CNF};
+
+    std::vector<Variable> result(_n_variables);
+    for (size_t i = 0; i < result.size(); i++)
+        result[i] = -static_cast<Variable>(i + 1);
+    for (auto const node : _chosen)
+        result[_variable[node] - 1] = _variable[node];
+
+    return SatSolution{SatSatisfiable::SATISFIABLE, _n_variables, result, SATFormat::CNF};
+}
+
+void DlxSolver::cover(int column)
+{
+    _right[_left[column]] = _right[column];
+    _left[_right[column]] = _left[column];
+    for (int row = _down[column]; row != column; row = _down[row])
+        for (int node = _right[row]; node != row; node = _right[node])
+        {
+            _down[_up[node]] = _down[node];
+            _up[_down[node]] = _up[node];
+            _size[_column[node]]--;
+        }
+}
+
+void DlxSolver::uncover(int column)
+{
+    for (int row = _up[column]; row != column; row = _up[row])
+        for (int node = _left[row]; node != row; node = _left[node])
+        {
+            _size[_column[node]]++;
+            _down[_up[node]] = node;
+            _up[_down[node]] = node;
+        }
+    _right[_left[column]] = column;
+    _left[_right[column]] = column;
+}
+
+bool DlxSolver::search()
+{
+    _nodes++;
+    if (_right[0] == 0)
+        return true;
+
+    // Column with fewest rows, a dead end is found right away when some column is empty
+    int column = _right[0];
+    for (int c = _right[column]; c != 0; c = _right[c])
+        if (_size[c] < _size[column])
+            column = c;
+    if (_size[column] == 0)
+        return false;
+
+    cover(column);
+    for (int row = _down[column]; row != column; row = _down[row])
+    {
+        _chosen.push_back(row);
+        for (int node = _right[row]; node != row; node = _right[node])
+            cover(_column[node]);
+
+        if (search())
+            return true;
+
+        for (int node = _left[row]; node != row; node = _left[node])
+            uncover(_column[node]);
+        _chosen.pop_back();
+    }
+    uncover(column);
+
+    return false;
+}
@@ -0,0 +1,54 @@
+#ifndef DLX_SOLVER_HPP
+#define DLX_SOLVER_HPP
+#include <vector>
+#include "SatSolver.hpp"
+#include "Sudoku.hpp"
+
+/// @brief Exact cover solver for sudokus, using Knuth's Algorithm X with dancing links. Each candidate digit of 
+/// each empty cell is a row, covering its cell and the digit in its row, column and region. No CNF is built, 
+/// and solutions are returned as a SatSolution over the sudoku's variable map, like the SAT route does
+class DlxSolver
+{
+    public:
+        /// @brief Build the exact cover matrix from the candidates of a sudoku. Builds its variable map
+        /// @param sudoku sudoku to solve, propagated or not
+        explicit DlxSolver(Sudoku& sudoku);
+
+        /// @brief Search for a solution. The matrix is left as the solution found, so call it only once
+        /// @return A solution where variables of chosen rows are true and the rest false, ready for 
+        /// Sudoku::add_sat_solution. UNSATISFIABLE if there's no exact cover
+        SatSolution solve();
+
+        /// @brief Get number of search nodes explored by the last call to solve
+        size_t get_nodes() const { return _nodes; }
+
+    private:
+        /// @brief Remove a column and every row that intersects it
+        void cover(int column);
+
+        /// @brief Undo cover, in reverse order
+        void uncover(int column);
+
+        /// @brief Recursive Algorithm X, choosing the column with fewest rows first
+        /// @return true if every column was covered. Chosen rows are in _chosen
+        bool search();
+
+        /// @brief Add a node to the matrix, at the bottom of its column
+        /// @return index of the new node
+        int add_node(int column, Variable variable);
+
+    private:
+        // Nodes are indices into these arrays. Node 0 is the root, nodes 1..n_columns are column headers
+        std::vector<int> _left, _right, _up, _down, _column;
+        /// @brief Number of rows in each column, only meaningful for headers
+        std::vector<int> _size;
+        /// @brief Variable of the row each node belongs to
+        std::vector<Variable> _variable;
+        /// @brief A node of each chosen row
+        std::vector<int> _chosen;
+        size_t _n_variables;
+        bool _consistent;
+        size_t _nodes = 0;
+};
+
+#endif
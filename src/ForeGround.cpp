@@ -1,10 +1,23 @@
 #include "ForeGround.hpp"
+#include "SatSudoku.hpp"
+#include "BitboardSolver.hpp"
+#include "SudokuGenerator.hpp"
+#include "SudokuSymmetry.hpp"
+#include "SudokuSession.hpp"
+#include "SudokuBackbone.hpp"
 
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <streambuf>
+#include <memory>
+#include <unordered_set>
 #include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+/// @brief Solutions kept in memory by --cache when no number is given
+static constexpr size_t default_cache_entries = 1024;
 
 sig_atomic_t ForeGround::finished ; 
 
@@ -15,8 +28,13 @@ void ForeGround::init() {
 STATUS ForeGround::read_sudoku(Sudoku &in_sudoku) {
     size_t sudoku_order = 0;
 
-    // Parse sudoku order
+    // Parse sudoku order. Candidate masks hold a bit per digit, which limits it to 8
     std::cin >> sudoku_order;
+    if (!std::cin || sudoku_order == 0 || sudoku_order * sudoku_order > 8 * sizeof(CandidateMask))
+    {
+        std::cerr << "Invalid sudoku order. Orders 1 to 8 are supported\n";
+        return FAILURE;
+    }
 
     // Create sudoku with specified size
     Sudoku sudoku(sudoku_order);
@@ -56,16 +74,45 @@ STATUS ForeGround::read_sudoku(Sudoku &in_sudoku) {
 
 
 STATUS ForeGround::sudoku_to_sat() {
+    // A lazy formula is only complete once the solver stops breaking it
+    if (_encoding.lazy)
+    {
+        std::cerr << "--lazy needs the solver in the loop, use it with --solveSudoku\n";
+        return FAILURE;
+    }
+    if (_encoding.all_different)
+    {
+        std::cerr << "--all-different needs the sudoku propagator in the solver, use it with --solveSudoku\n";
+        return FAILURE;
+    }
+
     Sudoku sudoku(0);
     
     auto status = read_sudoku(sudoku); 
     if (status == FAILURE)
         return FAILURE;
 
-    SatSolver sat = sudoku.as_sat();
+    // Clashing givens are reported and answered with a trivially unsatisfiable formula, no need to encode anything
+    auto const conflicts = sudoku.find_conflicts();
+    if (!conflicts.empty())
+    {
+        for (auto const& conflict : conflicts)
+            std::cerr << "Invalid sudoku: " << conflict.as_str() << std::endl;
+
+        DimacsWriter writer(std::cout, 1, 2);
+        writer.add_clause(Clause{1});
+        writer.add_clause(Clause{-1});
+        return SUCCESS;
+    }
 
+    // Whatever propagation deduces doesn't need to be encoded. If it solves the sudoku, the formula is empty
+    if (_propagate)
+        sudoku.propagate();
+
+    // Encoded once, straight into the solver's clause store, and simplified there before being written
+    SatSolver sat = sudoku.as_sat(_encoding);
     sat.simplify();
-    std::cout << sat.as_str();  
+    sat.write(std::cout);
 
     return SUCCESS;
 }
@@ -96,6 +143,14 @@ STATUS ForeGround::solver_caller()  {
     // * Solve SAT
 
     SatSolution solution;
+    sat.set_strategy(_strategy);
+    sat.set_seed(_seed);
+    sat.set_max_flips(_max_flips);
+    sat.set_mem_limit(_mem_limit);
+    if (_progress_interval != 0)
+        sat.add_hook([](const SatSolver& solver) {
+            std::cerr<<"c progress "<<solver.get_stats().as_str()<<". Memory: "<<solver.get_memory_usage().total()/1024.0<<"KB\n";
+        }, _progress_interval);
 
     auto solve_start = std::chrono::high_resolution_clock::now();
     sat.simplify();
@@ -103,7 +158,12 @@ STATUS ForeGround::solver_caller()  {
     auto solver_duration =  std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - solve_start);
     ForeGround::finished = 1 ;
 
-    std::cerr<<"Solved. Elapsed time: "<<solver_duration.count()/pow(10,6)<<"ms\n";
+    std::cerr<<"Solved. Elapsed time: "<<solver_duration.count()/pow(10,6)<<"ms. Peak memory: "<<sat.get_memory_usage().peak/1024.0<<"KB";
+    if (_stats_format == 1)
+        std::cerr<<". "<<sat.get_stats().as_str();
+    std::cerr<<"\n";
+    if (_stats_format == 2)
+        std::cerr<<"c stats "<<sat.get_stats().as_json()<<"\n";
 
     // * Display solution
 
@@ -112,6 +172,37 @@ STATUS ForeGround::solver_caller()  {
     return SUCCESS;
 }
 
+STATUS ForeGround::sudoku_file_caller(const std::string& file) {
+    SatSudoku app(_time, file, true, false, _propagate, _encoding, _backend, _count, _count_limit, _cache_entries, _cache_file);
+    app.run();
+
+    return SUCCESS;
+}
+
+STATUS ForeGround::estimate_caller()  {
+    // * Read SAT 
+    std::stringstream buffer;
+    buffer << std::cin.rdbuf();
+
+    SatSolver sat(std::vector<Clause>(), 0);
+
+    auto status = SatSolver::from_str_stream(buffer, sat);
+    if (status == FAILURE) 
+    {
+        return FAILURE;
+    }
+
+    // * Estimate search tree
+    sat.set_seed(_seed);
+    sat.set_mem_limit(_mem_limit);
+    sat.simplify();
+    auto estimate = sat.estimate_tree_size(_n_probes);
+
+    std::cout<<"c estimate "<<estimate.as_str()<<"\n";
+
+    return SUCCESS;
+}
+
 STATUS ForeGround::read_sat_solution(struct SatSolution& solution) {
 
     std::string line, mode;
@@ -245,7 +336,10 @@ STATUS ForeGround::sat_to_sudoku() {
     if (status == FAILURE) 
         return FAILURE;
 
-    solution.as_str();
+    // Propagate the same way --toSAT did, so the variable map matches
+    if (_propagate)
+        sudoku.propagate();
+    sudoku.set_dense(_encoding.dense);
     sudoku.add_sat_solution(solution);
 
     // * Display solved sudoku
@@ -253,4 +347,620 @@ STATUS ForeGround::sat_to_sudoku() {
     sudoku.display();
 
     return SUCCESS;
-}
\ No newline at end of file
+}
+
+STATUS ForeGround::batch_caller(const std::string& file) {
+    std::ifstream fs(file);
+    if (!fs)
+    {
+        std::cerr << "Could not open " << file << "\n";
+        return FAILURE;
+    }
+
+    // Parse everything first, so timing only covers solving
+    std::vector<Board81> puzzles;
+    std::vector<size_t> puzzle_lines;
+    std::string line;
+    size_t n_lines = 0;
+    while (std::getline(fs, line))
+    {
+        n_lines++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        // Same format as --solveSudoku, an order followed by digits separated by -
+        Board81 puzzle{};
+        char const* next = line.c_str();
+        char* end = nullptr;
+        bool valid = std::strtol(next, &end, 10) == 3 && end != next;
+        for (int c = 0; valid && c < 81; c++)
+        {
+            next = end + (c > 0 && *end == '-' ? 1 : 0);
+            auto const d = std::strtol(next, &end, 10);
+            valid = end != next && d >= 0 && d <= 9;
+            puzzle[c] = static_cast<uint8_t>(d);
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Skipping line " << n_lines << ": not an order 3 sudoku\n";
+            continue;
+        }
+        puzzles.push_back(puzzle);
+        puzzle_lines.push_back(n_lines);
+    }
+
+    BitboardSolver solver;
+    std::vector<Board81> solutions;
+    std::vector<bool> solved;
+    auto const start = std::chrono::high_resolution_clock::now();
+    auto const n_solved = solver.solve_batch(puzzles, solutions, solved);
+    auto const duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+
+    std::string output;
+    output.reserve(solutions.size() * 164);
+    for (auto const& solution : solutions)
+    {
+        output += "3 ";
+        for (int c = 0; c < 81; c++)
+        {
+            output += static_cast<char>('0' + solution[c]);
+            output += c < 80 ? '-' : '\n';
+        }
+    }
+    std::cout << output;
+
+    auto const seconds = std::max(duration.count(), static_cast<decltype(duration.count())>(1)) / 1e6;
+    std::cerr << "c " << n_solved << " of " << puzzles.size() << " sudokus solved in " << duration.count() << " us, " 
+              << static_cast<size_t>(puzzles.size() / seconds) << " sudokus/s, " << solver.get_guesses() << " guesses, " 
+              << BitboardSolver::instruction_set() << "\n";
+
+    if (!_verify)
+        return SUCCESS;
+
+    // Solve each one again through the SAT route. Sudokus with many solutions may get different ones, 
+    // so a disagreement is only an error if the bitboard answer breaks a rule or misses a solution
+    size_t n_errors = 0;
+    for (size_t p = 0; p < puzzles.size(); p++)
+    {
+        Sudoku sudoku(3);
+        for (int c = 0; c < 81; c++)
+            sudoku.get_board().set(c / 9, c % 9, puzzles[p][c]);
+        bool const sat_solved = sudoku.find_conflicts().empty() && [&sudoku]() {
+            // Same steps as --solveSudoku
+            auto const propagation = sudoku.propagate();
+            if (propagation != PropagationResult::PARTIAL)
+                return propagation == PropagationResult::SOLVED;
+
+            // Some of these take plain DPLL forever, local search gets through them
+            SatSolver sat = sudoku.as_sat(EncodingOptions());
+            sat.set_strategy(SolverStrategy::HYBRID);
+            sat.simplify();
+            auto const solution = sat.solve();
+            sudoku.add_sat_solution(solution);
+            return solution.satisfiable == SatSatisfiable::SATISFIABLE;
+        }();
+
+        bool same = true;
+        for (int c = 0; c < 81; c++)
+            same &= sudoku.get_board().get(c / 9, c % 9) == solutions[p][c];
+
+        bool valid = sat_solved == solved[p];
+        if (valid && solved[p] && !same)
+        {
+            Sudoku check(3);
+            for (int c = 0; c < 81; c++)
+            {
+                check.get_board().set(c / 9, c % 9, solutions[p][c]);
+                valid &= solutions[p][c] != 0 && (puzzles[p][c] == 0 || puzzles[p][c] == solutions[p][c]);
+            }
+            valid &= check.find_conflicts().empty();
+        }
+
+        if (!valid)
+        {
+            std::cerr << "Mismatch with SAT solution for sudoku at line " << puzzle_lines[p] << "\n";
+            n_errors++;
+        }
+    }
+    std::cerr << "c verified " << puzzles.size() - n_errors << " of " << puzzles.size() << " against SAT solutions\n";
+
+    return n_errors == 0 ? SUCCESS : FAILURE;
+}
+
+STATUS ForeGround::generate_caller(const std::string& n_sudokus_str) {
+    size_t n_sudokus = 0;
+    try 
+    {
+        n_sudokus = static_cast<size_t>(std::stoul(n_sudokus_str));
+    }
+    catch(std::exception const& ex)
+    {
+        std::cerr<<n_sudokus_str<<" is not a valid number of sudokus\n";
+        return FAILURE;
+    }
+
+    // Candidate masks limit orders to 8
+    if (_order < 2 || _order > 8)
+    {
+        std::cerr<<"Can't generate sudokus of order "<<_order<<", valid orders are 2 to 8\n";
+        return FAILURE;
+    }
+
+    auto const start = std::chrono::high_resolution_clock::now();
+    auto sudokus = SudokuGenerator::generate_batch(_order, n_sudokus, _seed, _min_givens, _threads);
+    auto const duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+
+    std::string output;
+    size_t n_givens = 0;
+    for (auto& sudoku : sudokus)
+    {
+        output += sudoku.as_str();
+        output += '\n';
+        for (size_t c = 0; c < _order * _order * _order * _order; c++)
+            n_givens += sudoku.get_board().get(c / (_order * _order), c % (_order * _order)) != 0;
+    }
+    std::cout << output;
+
+    auto const seconds = std::max(duration.count(), static_cast<decltype(duration.count())>(1)) / 1e6;
+    std::cerr << "c " << n_sudokus << " sudokus of order " << _order << " generated in " << duration.count() << " us, " 
+              << n_sudokus / seconds << " sudokus/s, " << (n_sudokus == 0 ? 0.0 : static_cast<double>(n_givens) / n_sudokus) 
+              << " givens on average\n";
+
+    return SUCCESS;
+}
+
+STATUS ForeGround::canonical_caller(const std::string& file) {
+    std::ifstream fs(file);
+    if (!fs)
+    {
+        std::cerr << "Could not open " << file << "\n";
+        return FAILURE;
+    }
+
+    std::vector<Sudoku> sudokus;
+    std::string line;
+    size_t n_lines = 0;
+    while (std::getline(fs, line))
+    {
+        n_lines++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        auto sudoku = Sudoku::from_str(line);
+        if (sudoku.get_order() == 0)
+        {
+            std::cerr << "Skipping line " << n_lines << ": not a valid sudoku\n";
+            continue;
+        }
+        sudokus.push_back(std::move(sudoku));
+    }
+
+    std::string output;
+    std::unordered_set<std::string> forms;
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (auto const& sudoku : sudokus)
+    {
+        auto const form = SudokuTransform::canonical(sudoku).apply(sudoku).as_str();
+        forms.insert(form);
+        output += form;
+        output += '\n';
+    }
+    auto const duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << output;
+
+    auto const seconds = std::max(duration.count(), static_cast<decltype(duration.count())>(1)) / 1e6;
+    std::cerr << "c " << sudokus.size() << " sudokus, " << forms.size() << " different up to symmetry, canonicalized in " 
+              << duration.count() << " us, " << static_cast<size_t>(sudokus.size() / seconds) << " sudokus/s\n";
+
+    return SUCCESS;
+}
+
+STATUS ForeGround::session_caller(const std::string& file) {
+    std::ifstream fs(file);
+    if (!fs)
+    {
+        std::cerr << "Could not open " << file << "\n";
+        return FAILURE;
+    }
+
+    std::unique_ptr<SudokuSession> session;
+    std::string line, output;
+    size_t n_lines = 0, n_grids = 0, n_solved = 0;
+    std::chrono::microseconds total(0), slowest(0);
+    while (std::getline(fs, line))
+    {
+        n_lines++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        auto const sudoku = Sudoku::from_str(line);
+        if (sudoku.get_order() == 0 || (session && sudoku.get_order() != session->get_givens().get_order()))
+        {
+            std::cerr << "Skipping line " << n_lines << ": not a valid sudoku of the session's order\n";
+            continue;
+        }
+
+        // The first grid builds the session, which isn't part of an edit's latency
+        if (!session)
+            session = std::make_unique<SudokuSession>(sudoku);
+
+        auto const start = std::chrono::high_resolution_clock::now();
+        auto const& result = session->update(sudoku);
+        auto const duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+        total += duration;
+        slowest = std::max(slowest, duration);
+        n_grids++;
+
+        if (result.satisfiable == SatSatisfiable::SATISFIABLE)
+        {
+            n_solved++;
+            output += result.solution.as_str();
+        }
+        else
+        {
+            output += sudoku.as_str();
+            for (auto const& conflict : result.conflicts)
+                std::cerr << "c line " << n_lines << ": " << conflict.as_str() << "\n";
+        }
+        output += '\n';
+    }
+    std::cout << output;
+
+    std::cerr << "c " << n_grids << " grids, " << n_solved << " solved, " << (session ? session->get_solver_calls() : 0) 
+              << " searches, " << (n_grids == 0 ? 0 : total.count() / static_cast<double>(n_grids)) << " us per grid on average, "
+              << slowest.count() << " us at most\n";
+
+    return SUCCESS;
+}
+
+STATUS ForeGround::backbone_caller(const std::string& file) {
+    std::ifstream fs(file);
+    if (!fs)
+    {
+        std::cerr << "Could not open " << file << "\n";
+        return FAILURE;
+    }
+
+    // One solver per order, built when the first sudoku of that order shows up
+    std::unique_ptr<SudokuBackbone> backbone;
+    std::string line, output;
+    size_t n_lines = 0, n_sudokus = 0, n_givens = 0, n_fixed = 0, n_undecided = 0, calls_before = 0;
+    std::chrono::microseconds total(0);
+    while (std::getline(fs, line))
+    {
+        n_lines++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        auto const sudoku = Sudoku::from_str(line);
+        if (sudoku.get_order() == 0)
+        {
+            std::cerr << "Skipping line " << n_lines << ": not a valid sudoku\n";
+            continue;
+        }
+
+        auto const start = std::chrono::high_resolution_clock::now();
+        if (!backbone || backbone->get_order() != sudoku.get_order())
+        {
+            calls_before += backbone ? backbone->get_solver_calls() : 0;
+            backbone = std::make_unique<SudokuBackbone>(sudoku.get_order());
+        }
+        auto const result = backbone->compute(sudoku);
+        total += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+        n_sudokus++;
+
+        if (result.satisfiable != SatSatisfiable::SATISFIABLE)
+        {
+            std::cerr << "c line " << n_lines << ": " << (result.satisfiable == SatSatisfiable::UNSATISFIABLE ? "no solution" : "gave up") << "\n";
+            output += sudoku.as_str();
+            output += '\n';
+            continue;
+        }
+
+        auto const n2 = static_cast<int>(sudoku.get_order() * sudoku.get_order());
+        for (int c = 0; c < n2 * n2; c++)
+        {
+            n_givens += sudoku.get_board().get(c / n2, c % n2) != 0;
+            n_fixed += result.backbone.get_board().get(c / n2, c % n2) != 0;
+        }
+        n_undecided += result.undecided;
+        output += result.backbone.as_str();
+        output += '\n';
+    }
+    std::cout << output;
+
+    std::cerr << "c " << n_sudokus << " sudokus, " << n_fixed - n_givens << " cells fixed besides " << n_givens << " givens, " 
+              << n_undecided << " undecided, " << calls_before + (backbone ? backbone->get_solver_calls() : 0) << " searches, "
+              << (n_sudokus == 0 ? 0 : total.count() / static_cast<double>(n_sudokus)) << " us per sudoku on average\n";
+
+    return SUCCESS;
+}
+
+STATUS ForeGround::parse_flag(const std::string& flag) {
+    auto const separator = flag.find('=');
+    auto const name = flag.substr(0, separator);
+    auto const value = separator == std::string::npos ? std::string() : flag.substr(separator + 1);
+
+    if (name.compare("--strategy") == 0) 
+    {
+        if (value.compare("watchlist") == 0)
+            _strategy = SolverStrategy::WATCHLIST;
+        else if (value.compare("local") == 0)
+            _strategy = SolverStrategy::LOCAL_SEARCH;
+        else if (value.compare("hybrid") == 0)
+            _strategy = SolverStrategy::HYBRID;
+        else if (value.compare("lookahead") == 0)
+            _strategy = SolverStrategy::LOOKAHEAD;
+        else 
+        {
+            std::cerr<<value<<" is not a valid strategy. Options are 'watchlist', 'local', 'hybrid' and 'lookahead'\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--seed") == 0) 
+    {
+        try 
+        {
+            _seed = static_cast<unsigned int>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid seed\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--max-flips") == 0) 
+    {
+        try 
+        {
+            _max_flips = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of flips\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--mem-limit") == 0) 
+    {
+        try 
+        {
+            size_t parsed = 0;
+            auto const megabytes = std::stod(value, &parsed);
+            // Negative or huge values would overflow the cast to bytes
+            if (parsed != value.size() || !(megabytes >= 0 && megabytes < 1e12))
+                throw std::invalid_argument(value);
+            _mem_limit = static_cast<size_t>(megabytes * 1024 * 1024);
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid memory limit\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--stats") == 0) 
+    {
+        if (value.empty())
+            _stats_format = 1;
+        else if (value.compare("json") == 0)
+            _stats_format = 2;
+        else 
+        {
+            std::cerr<<value<<" is not a valid stats format. Only option is 'json'\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--progress") == 0) 
+    {
+        try 
+        {
+            _progress_interval = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of decisions\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--probes") == 0) 
+    {
+        try 
+        {
+            _n_probes = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of probes\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--amo") == 0) 
+    {
+        if (value.compare("pairwise") == 0)
+            _encoding.amo = AmoEncoding::PAIRWISE;
+        else if (value.compare("sequential") == 0)
+            _encoding.amo = AmoEncoding::SEQUENTIAL;
+        else if (value.compare("commander") == 0)
+            _encoding.amo = AmoEncoding::COMMANDER;
+        else if (value.compare("product") == 0)
+            _encoding.amo = AmoEncoding::PRODUCT;
+        else if (value.compare("auto") == 0)
+            _encoding.amo = AmoEncoding::AUTO;
+        else 
+        {
+            std::cerr<<value<<" is not a valid at most one encoding. Options are 'pairwise', 'sequential', 'commander', 'product' and 'auto'\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--encode-threads") == 0) 
+    {
+        try 
+        {
+            _encoding.threads = static_cast<unsigned int>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of threads\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--backend") == 0) 
+    {
+        if (value.compare("sat") == 0)
+            _backend = SolverBackend::SAT;
+        else if (value.compare("dlx") == 0)
+            _backend = SolverBackend::DLX;
+        else if (value.compare("bitboard") == 0)
+            _backend = SolverBackend::BITBOARD;
+        else 
+        {
+            std::cerr<<value<<" is not a valid backend. Options are 'sat', 'dlx' and 'bitboard'\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--dense") == 0) 
+    {
+        _encoding.dense = true;
+        return SUCCESS;
+    }
+    else if (name.compare("--lazy") == 0) 
+    {
+        _encoding.lazy = true;
+        return SUCCESS;
+    }
+    else if (name.compare("--all-different") == 0) 
+    {
+        _encoding.all_different = true;
+        return SUCCESS;
+    }
+    else if (name.compare("--extended") == 0) 
+    {
+        _encoding.extended = true;
+        return SUCCESS;
+    }
+    else if (name.compare("--break-symmetries") == 0) 
+    {
+        _encoding.break_symmetries = true;
+        return SUCCESS;
+    }
+    else if (name.compare("--count") == 0) 
+    {
+        _count = true;
+        if (value.empty())
+            return SUCCESS;
+        try 
+        {
+            _count_limit = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of solutions\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--cache") == 0) 
+    {
+        _cache_entries = default_cache_entries;
+        if (value.empty())
+            return SUCCESS;
+        try 
+        {
+            _cache_entries = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of cache entries\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--cache-file") == 0) 
+    {
+        if (value.empty())
+        {
+            std::cerr<<"--cache-file needs a file\n";
+            return FAILURE;
+        }
+        _cache_file = value;
+        if (_cache_entries == 0)
+            _cache_entries = default_cache_entries;
+        return SUCCESS;
+    }
+    else if (name.compare("--order") == 0) 
+    {
+        try 
+        {
+            _order = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid order\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--givens") == 0) 
+    {
+        try 
+        {
+            _min_givens = static_cast<size_t>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of givens\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--threads") == 0) 
+    {
+        try 
+        {
+            _threads = static_cast<unsigned int>(std::stoul(value));
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid number of threads\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+    else if (name.compare("--verify") == 0) 
+    {
+        _verify = true;
+        return SUCCESS;
+    }
+    else if (name.compare("--no-propagation") == 0) 
+    {
+        _propagate = false;
+        return SUCCESS;
+    }
+    else if (name.compare("--time") == 0) 
+    {
+        try 
+        {
+            _time = std::stof(value);
+        }
+        catch(std::exception const& ex)
+        {
+            std::cerr<<value<<" is not a valid time\n";
+            return FAILURE;
+        }
+        return SUCCESS;
+    }
+
+    std::cerr<<flag<<" Is not a valid flag of SatSolver\n";
+    return FAILURE;
+}
@@ -2,6 +2,7 @@
 #define ORCHESTRATION_HPP
 
 #include "Sudoku.hpp"
+#include "SatSudoku.hpp"
 
 #include <iostream>
 #include <csignal>
@@ -19,10 +20,87 @@ public:
     STATUS sudoku_to_sat();
 
     static void usr_sig_handler(int sig_id) ;
-    static STATUS solver_caller();
+    STATUS solver_caller();
+    STATUS estimate_caller();
+    STATUS sudoku_file_caller(const std::string& file);
+
+    /// @brief Solve every order 3 sudoku in a file with BitboardSolver, print solutions to stdout and 
+    /// throughput to stderr. With --verify, check each one against the SAT route
+    /// @param file sudokus, one per line, same format as --solveSudoku
+    /// @return SUCCESS if file was read and, when verifying, every answer matched
+    STATUS batch_caller(const std::string& file);
+
+    /// @brief Generate sudokus with a single solution and print them to stdout, one per line in the same format 
+    /// as --solveSudoku, and throughput to stderr
+    /// @param n_sudokus_str how many sudokus to generate
+    /// @return SUCCESS if n_sudokus_str and --order were valid
+    STATUS generate_caller(const std::string& n_sudokus_str);
+
+    /// @brief Print the canonical form of every sudoku in a file to stdout, one per line, and to stderr how many
+    /// different ones there were and how long it took
+    /// @param file sudokus, one per line, same format as --solveSudoku
+    /// @return SUCCESS if file could be read
+    STATUS canonical_caller(const std::string& file);
+
+    /// @brief Replay the edits of an interactive session: each line of a file is the whole grid after an edit, 
+    /// solved again by a SudokuSession. Print a solution per line to stdout, the grid itself if it has none, and
+    /// conflicts and latency to stderr
+    /// @param file grids of the same order, one per line, same format as --solveSudoku
+    /// @return SUCCESS if file could be read
+    STATUS session_caller(const std::string& file);
+
+    /// @brief Print the backbone of every sudoku in a file to stdout, one per line with 0 in cells where solutions
+    /// differ, or the sudoku itself if it has no solution, and to stderr how many cells were fixed and how many
+    /// searches it took
+    /// @param file sudokus, one per line, same format as --solveSudoku
+    /// @return SUCCESS if file could be read
+    STATUS backbone_caller(const std::string& file);
 
     STATUS read_sat_solution(struct SatSolution& solution);
     STATUS sat_to_sudoku();
+
+    /// @brief Parse an optional flag from the command line, like --strategy=hybrid
+    /// @param flag flag to parse 
+    /// @return SUCCESS if flag was recognized and valid, FAILURE otherwise
+    STATUS parse_flag(const std::string& flag);
+
+private:
+    // Solver configuration, set from command line flags
+    SolverStrategy _strategy = SolverStrategy::WATCHLIST;
+    unsigned int _seed = 42;
+    // Flips a local search run makes before giving up
+    size_t _max_flips = 1000000;
+    // Memory limit in bytes, 0 for no limit
+    size_t _mem_limit = 0;
+    // Print solver stats: 0 don't, 1 human readable, 2 json
+    int _stats_format = 0;
+    // Decisions between progress reports, 0 for no reports
+    size_t _progress_interval = 0;
+    // Number of probes used by the search tree estimator
+    size_t _n_probes = 64;
+    // If sudokus should be propagated before encoding. Must match between --toSAT and --toSudoku
+    bool _propagate = true;
+    // Options for sudoku to SAT encoding
+    EncodingOptions _encoding;
+    // Backend used by --solveSudoku
+    SolverBackend _backend = SolverBackend::SAT;
+    // Count solutions in --solveSudoku, up to a limit if it's not 0
+    bool _count = false;
+    size_t _count_limit = 0;
+    // Solutions kept in memory by --solveSudoku's cache, 0 for no cache
+    size_t _cache_entries = 0;
+    // File for the solution cache, empty to keep it in memory only
+    std::string _cache_file;
+    // Check --solveBatch answers against SAT solutions
+    bool _verify = false;
+    // Max time in seconds to solve each sudoku in a file, 0 to wait forever
+    float _time = 0;
+    // Order of sudokus made by --generate
+    size_t _order = 3;
+    // Givens --generate stops at, 0 to remove as many as possible
+    size_t _min_givens = 0;
+    // Threads used by --generate, 0 for one per core
+    unsigned int _threads = 0;
 } ;
 
 
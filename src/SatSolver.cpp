@@ -4,6 +4,9 @@
 #include <set>
 #include <algorithm>
 #include <queue>
+#include <random>
+#include <cmath>
+#include <chrono>
 #include "Instrumentor.hpp"
 
 std::string SatSolution::as_str()
@@ -26,14 +29,130 @@ std::string SatSolution::as_str()
     return ss.str();
 }
 
+std::string SatSolverStats::as_str() const
+{
+    std::stringstream ss;
+    ss << "Decisions: " << decisions << ". Propagations: " << propagations << " (" << custom_propagations << " custom). Conflicts: " << conflicts 
+       << ". Backtracks: " << backtracks << ". Lookaheads: " << look_aheads << ". Flips: " << flips << ". Max depth: " << max_depth 
+       << ". Preprocess: " << preprocess_ms << "ms. Local search: " << local_search_ms << "ms. Search: " << search_ms << "ms";
+
+    return ss.str();
+}
+
+std::string SatSolverStats::as_json() const
+{
+    std::stringstream ss;
+    ss << "{\"decisions\":" << decisions << ",\"propagations\":" << propagations << ",\"custom_propagations\":" << custom_propagations << ",\"conflicts\":" << conflicts
+       << ",\"backtracks\":" << backtracks << ",\"look_aheads\":" << look_aheads << ",\"flips\":" << flips << ",\"max_depth\":" << max_depth
+       << ",\"preprocess_ms\":" << preprocess_ms << ",\"local_search_ms\":" << local_search_ms << ",\"search_ms\":" << search_ms << "}";
+
+    return ss.str();
+}
+
+std::string SatTreeEstimate::as_str() const
+{
+    std::stringstream ss;
+    ss << "probes=" << probes << " nodes=" << nodes << " nodes_error=" << nodes_error << " seconds=" << seconds << " solutions=" << solutions;
+
+    return ss.str();
+}
+
 SatSolver::SatSolver(const std::vector<Clause>& clauses, size_t n_variables, SATFormat format)
     : _n_variables(n_variables) 
     , _n_clauses(clauses.size())
     , _format(format)
     , _clauses(clauses)
 
+{ 
+    _memory.clauses = clauses_bytes(_clauses);
+    _memory.peak = _memory.total();
+}
+
+SatSolver::SatSolver(size_t n_variables, SATFormat format)
+    : _n_variables(n_variables) 
+    , _n_clauses(0)
+    , _format(format)
 { }
 
+void SatSolver::add_clause(const Clause& clause)
+{
+    _n_clauses++;
+    if (!_prepared)
+    {
+        store_clause(Clause(clause));
+        return;
+    }
+
+    // Between calls to solve clauses are in literal format, and preprocessing already fixed some variables
+    assert((!_pure_literal_elimination || _propagator != nullptr) && "Pure literal elimination may have dropped models of this clause");
+    Clause reduced;
+    for (auto const var : clause)
+    {
+        auto const value = _root_state[abs(var)];
+        if (value == expected_value(var))
+            return;
+        if (value == -1)
+            reduced.push_back(variable_to_literal(var));
+    }
+
+    if (reduced.empty())
+        _unsatisfiable = true;
+    else
+        store_clause(std::move(reduced));
+}
+
+void SatSolver::add_clauses(const Variable* literals, size_t n_literals)
+{
+    // Once prepared each clause has to be reduced against what preprocessing fixed
+    if (_prepared)
+    {
+        ClauseSink::add_clauses(literals, n_literals);
+        return;
+    }
+
+    auto const end = literals + n_literals;
+    auto const n_clauses = static_cast<size_t>(std::count(literals, end, 0));
+    _n_clauses += n_clauses;
+    auto const old_capacity = _clauses.capacity();
+    _clauses.reserve(_clauses.size() + n_clauses);
+    _memory.clauses += (_clauses.capacity() - old_capacity) * sizeof(Clause);
+    for (auto first = literals; first != end; )
+    {
+        auto const last = std::find(first, end, 0);
+        store_clause(Clause(first, last));
+        first = last == end ? end : last + 1;
+    }
+}
+
+void SatSolver::set_n_variables(size_t n_variables)
+{
+    if (!_prepared)
+    {
+        _n_variables = n_variables;
+        return;
+    }
+
+    // Preprocessing sized its tables for the old count. New variables are decided after the old ones
+    assert(n_variables >= _n_variables && "Variables can't be removed once prepared");
+    for (auto var = static_cast<Variable>(_n_variables) + 1; static_cast<size_t>(var) <= n_variables; var++)
+        _sorted_variables.push_back(var);
+    _n_variables = n_variables;
+    _root_state.resize(_n_variables + 1, -1);
+    _positive_repetitions.resize(_n_variables + 1, 0);
+    _negative_repetitions.resize(_n_variables + 1, 0);
+    if (!_phase.empty())
+        _phase.resize(_n_variables + 1, -1);
+}
+
+void SatSolver::store_clause(Clause&& clause)
+{
+    auto const old_capacity = _clauses.capacity();
+    _memory.clauses += clause.capacity() * sizeof(Variable);
+    _clauses.emplace_back(std::move(clause));
+    _memory.clauses += (_clauses.capacity() - old_capacity) * sizeof(Clause);
+    _memory.peak = std::max(_memory.peak, _memory.total());
+}
+
 STATUS SatSolver::from_str(const std::string& sat_str, SatSolver& out_result)
 {
     std::stringstream ss(sat_str);
@@ -111,7 +230,12 @@ STATUS SatSolver::from_str_stream(std::stringstream& sat_str_stream, SatSolver&
 std::string SatSolver::as_str() const
 {
     std::stringstream ss;
+    write(ss);
+    return ss.str();
+}
 
+void SatSolver::write(std::ostream& ss) const
+{
     std::string format_str;
     switch (_format)
     {
@@ -123,29 +247,198 @@ std::string SatSolver::as_str() const
         break;
     }
 
-    // Write header
-    ss << "p " << format_str << " " << _n_variables << " " << _n_clauses << std::endl;
+    // Write header. Simplifying may have dropped clauses since they were added
+    ss << "p " << format_str << " " << _n_variables << " " << _clauses.size() << "\n";
     for (const auto &clause : _clauses )
     {
         for (const auto &var : clause)
             ss << var << " "; 
         ss << "0\n";
     }
-
-    return ss.str();
 }
 
-SatSolution SatSolver::solve()
+SatSolution SatSolver::solve(const std::vector<Variable>& assumptions)
 {
     PROFILE_SESSION_BEGIN("solve_profile", "./solve_profiling.json");
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    _limit_reached = false;
+    _stats = SatSolverStats();
+    _depth = 0;
+
+    auto phase_start = std::chrono::high_resolution_clock::now();
+    prepare();
+    _stats.preprocess_ms = milliseconds(std::chrono::high_resolution_clock::now() - phase_start).count();
+    if (_limit_reached)
+    {
+        PROFILE_SESSION_END();
+        return SatSolution{SatSatisfiable::UNKNOWN, 0, std::vector<Variable>(), SATFormat::CNF};
+    }
+
+    if (_unsatisfiable)
+    {
+        PROFILE_SESSION_END();
+        return SatSolution{SatSatisfiable::UNSATISFIABLE, 0, std::vector<Variable>(), SATFormat::CNF};
+    }
+
+    // Start search from the state deduced in preprocessing
+    std::vector<int> state(_root_state);
+    _memory.trail = 2 * state.capacity() * sizeof(int);
+
+    bool solved_by_local_search = false;
+    if ((_strategy == SolverStrategy::LOCAL_SEARCH || _strategy == SolverStrategy::HYBRID) && !_clauses.empty())
+    {
+        std::vector<int> best_state;
+        phase_start = std::chrono::high_resolution_clock::now();
+        solved_by_local_search = local_search(state, best_state);
+        _stats.local_search_ms = milliseconds(std::chrono::high_resolution_clock::now() - phase_start).count();
+        // Local search only sees clauses. With a propagator or assumptions its model is only a hint for the search below
+        if (solved_by_local_search && _propagator == nullptr && assumptions.empty())
+            state = best_state;
+        else if ((_strategy == SolverStrategy::LOCAL_SEARCH && !solved_by_local_search) || _limit_reached)
+        {
+            PROFILE_SESSION_END();
+            return SatSolution{SatSatisfiable::UNKNOWN, 0, std::vector<Variable>(), SATFormat::CNF};
+        }
+        else // Hybrid: branch first on the values of the best assignment found so far
+        {
+            _phase = best_state;
+            solved_by_local_search = false;
+        }
+    }
+
+    bool satisfiable = true;
+    _backtrack_to_projected = false;
+    if ((!_clauses.empty() || _propagator != nullptr || !assumptions.empty() || _on_model != nullptr) && !solved_by_local_search)
+    {
+        _search_start = std::chrono::high_resolution_clock::now();
+        auto watchlist = create_watchlist(state);
+        _memory.watches = watchlist_bytes(watchlist);
+
+        // The propagator hasn't seen what preprocessing assigned
+        std::vector<int> root_implications;
+        for (int var = 1; _propagator != nullptr && satisfiable && static_cast<size_t>(var) <= _n_variables; var++)
+            if (_root_state[var] != -1)
+                satisfiable = propagate_custom(watchlist, var, state, root_implications);
+
+        // Assumptions are propagated like decisions taken before the search. state is a copy, so they don't last
+        for (auto const literal : assumptions)
+        {
+            if (!satisfiable)
+                break;
+            auto const var = abs(literal);
+            int const value = expected_value(literal);
+            if (state[var] == value)
+                continue;
+            satisfiable = state[var] == -1;
+            state[var] = value;
+            satisfiable = satisfiable && update_watchlist(watchlist, (var << 1) | value, state, root_implications);
+        }
+
+        if (!satisfiable || !check_memory())
+            satisfiable = false;
+        else if (_strategy == SolverStrategy::LOOKAHEAD)
+            satisfiable = solve_by_lookahead(watchlist, state);
+        else if (_on_model != nullptr)
+        {
+            // Projected variables are decided first, so past them a branch can only repeat the model it finds
+            auto variables = _sorted_variables;
+            std::stable_partition(variables.begin(), variables.end(), [this](Variable var) { return static_cast<size_t>(var) <= _n_projected; });
+            satisfiable = solve_by_watchlist(watchlist, state, variables, _positive_repetitions, _negative_repetitions);
+        }
+        else
+            satisfiable = solve_by_watchlist(watchlist, state, _sorted_variables, _positive_repetitions, _negative_repetitions);
+        _memory.watches = 0;
+        _stats.search_ms = milliseconds(std::chrono::high_resolution_clock::now() - _search_start).count();
+    }
+
+    if (_limit_reached)
+    {
+        PROFILE_SESSION_END();
+        return SatSolution{SatSatisfiable::UNKNOWN, 0, std::vector<Variable>(), SATFormat::CNF};
+    }
+
+    if (!satisfiable)
+    {
+        PROFILE_SESSION_END();
+        return SatSolution{SatSatisfiable::UNSATISFIABLE, 0, std::vector<Variable>(), SATFormat::CNF};
+    }
+
+    PROFILE_SESSION_END();
+    return build_solution(state);
+}
+
+SatSolution SatSolver::build_solution(const std::vector<int>& state) const
+{
+    std::vector<Variable> result(_n_variables);
+    for(int i = 0; static_cast<size_t>(i) < result.size(); i++)
+        if (state[i+1] == 1)
+            result[i] = (i+1); 
+        else
+            result[i] = -(i+1); // set insecure variables to false, we want the minimum amount of trues
+
+    return SatSolution{SatSatisfiable::SATISFIABLE, _n_variables, result, SATFormat::CNF};
+}
+
+SatSolution SatSolver::enumerate(size_t n_projected, const std::function<bool(const SatSolution&)>& on_model, const std::vector<Variable>& assumptions)
+{
+    // Only the watchlist search has branches to go back to
+    auto const strategy = _strategy;
+    _strategy = SolverStrategy::WATCHLIST;
+    _n_projected = n_projected;
+    _on_model = &on_model;
+    auto solution = solve(assumptions);
+    _on_model = nullptr;
+    _strategy = strategy;
+    return solution;
+}
+
+bool SatSolver::report_model(const std::vector<int>& state)
+{
+    if (!(*_on_model)(build_solution(state)))
+        return true;
+
+    _backtrack_to_projected = true;
+    return false;
+}
+
+void SatSolver::set_phase(const std::vector<int>& phase)
+{
+    _phase = phase;
+    if (!_phase.empty())
+        _phase.resize(_n_variables + 1, -1);
+}
+
+void SatSolver::prepare()
+{
+    if (_prepared)
+        return;
+
+    // Don't even allocate state if it doesn't fit
+    _memory.trail = (_n_variables + 1) * sizeof(int);
+    if (!check_memory())
+        return;
+
     // Initialize state as -1, each variable can be modified as needed
-    std::vector<int> state(_n_variables + 1, -1);
+    _root_state = std::vector<int>(_n_variables + 1, -1);
 
     // Initialize unit clauses to their corresponding value to save computation
-    reduce_unit_clauses(_clauses, state);
+    reduce_unit_clauses(_clauses, _root_state);
 
-    // Reduce literals 
-    literal_elimination(_clauses, state);
+    // Contradicting unit clauses leave an empty clause behind, nothing else to do
+    if (std::any_of(_clauses.begin(), _clauses.end(), [](const Clause& clause) { return clause.empty(); }))
+    {
+        _unsatisfiable = true;
+        _clauses.clear();
+        _sorted_variables.clear();
+        _positive_repetitions = std::vector<size_t>(_n_variables+1, 0);
+        _negative_repetitions = std::vector<size_t>(_n_variables+1, 0);
+        _prepared = true;
+        return;
+    }
+
+    // Reduce literals. A pure literal may still be constrained by the propagator or by clauses added later
+    if (_propagator == nullptr && _pure_literal_elimination)
+        literal_elimination(_clauses, _root_state);
     simplify();
 
     // -- Experimento: Queremos ver si con la optimización de prioridad por frecuencia
@@ -153,8 +446,8 @@ SatSolution SatSolver::solve()
     // en la expresión original y ordenarlas por repeticiones
 
     std::map<Variable, size_t> repetitions;
-    std::vector<size_t> positive_repetitions(_n_variables+1, 0);
-    std::vector<size_t> negative_repetitions(_n_variables+1, 0);
+    _positive_repetitions = std::vector<size_t>(_n_variables+1, 0);
+    _negative_repetitions = std::vector<size_t>(_n_variables+1, 0);
 
     for(int i = 1; static_cast<size_t>(i) <= _n_variables; i++)
         repetitions[i] = 0;
@@ -166,9 +459,9 @@ SatSolution SatSolver::solve()
             auto const elem_abs = abs(elem);
             repetitions[elem_abs] ++;
             if (elem < 0)
-                negative_repetitions[elem_abs]++;
+                _negative_repetitions[elem_abs]++;
             else if (elem > 0)
-                positive_repetitions[elem_abs]++;
+                _positive_repetitions[elem_abs]++;
             else 
             {
                 assert(false && "invalid variable == 0");
@@ -179,35 +472,21 @@ SatSolution SatSolver::solve()
     std::priority_queue<std::pair<size_t, Variable>> variables_per_repetition;
     for(auto const& [var, reps] : repetitions)
         variables_per_repetition.emplace(reps, var);
-    std::vector<Variable> sorted_variables;
+    _sorted_variables.clear();
     for(size_t i = 0; i < _n_variables && !variables_per_repetition.empty(); i++)
     {
         auto const [reps, var] = variables_per_repetition.top();
-        if (state[var] == -1)
-            sorted_variables.push_back(var);
+        if (_root_state[var] == -1)
+            _sorted_variables.push_back(var);
         variables_per_repetition.pop();
     }
     // -----------------------------------------------------------------------------------
 
     // Convert clauses to literals
     clauses_to_literal();
-    auto watchlist = create_watchlist(state);
-    if (!_clauses.empty() && !solve_by_watchlist(watchlist, state, sorted_variables, positive_repetitions, negative_repetitions))
-    {
-        return SatSolution{SatSatisfiable::UNSATISFIABLE, 0, std::vector<Variable>(), SATFormat::CNF};
-    }
-
-    // Build result
-    std::vector<Variable> result(_n_variables);
-    for(int i = 0; static_cast<size_t>(i) < result.size(); i++)
-        if (state[i+1] == 1)
-            result[i] = (i+1); 
-        else
-            result[i] = -(i+1); // set insecure variables to false, we want the minimum amount of trues
-
-
-    PROFILE_SESSION_END();
-    return SatSolution{SatSatisfiable::SATISFIABLE, _n_variables, result, SATFormat::CNF};
+    _memory.clauses = clauses_bytes(_clauses);
+    _prepared = true;
+    check_memory();
 }
 
 void SatSolver::simplify()
@@ -302,7 +581,7 @@ bool SatSolver::check_watchlist_invariant(const std::vector<int>& state, const W
     return true;
 }
 
-bool SatSolver::update_watchlist(Watchlist& watchlist, int neg_literal, std::vector<int>& state, std::vector<int>& implications) const
+bool SatSolver::update_watchlist(Watchlist& watchlist, int neg_literal, std::vector<int>& state, std::vector<int>& implications)
 {
     std::vector<int> update_implications;
 
@@ -322,7 +601,9 @@ bool SatSolver::update_watchlist(Watchlist& watchlist, int neg_literal, std::vec
             if (state[variable] == -1 || state[variable] == (parity ^ 1))
             {
                 alternative_found = true;
+                auto const old_capacity = watchlist[alternative].capacity();
                 watchlist[alternative].emplace_back(clause_index);
+                _memory.watches += (watchlist[alternative].capacity() - old_capacity) * sizeof(size_t);
                 remove_last = true;
                 // Count how many alternatives in this clause match this criteria
                 size_t count = 0;
@@ -348,12 +629,14 @@ bool SatSolver::update_watchlist(Watchlist& watchlist, int neg_literal, std::vec
             watchlist[neg_literal].pop_back();
         if (!alternative_found)
         {
+            _stats.conflicts++;
             for(auto const impl : update_implications)
                     state[impl] = -1;
             return false;
         }
         if (alternative_is_implication)
         {
+            _stats.propagations++;
             state[implication] = parity ^ 1;
             if (!update_watchlist(watchlist, (implication << 1) | state[implication], state, update_implications))
             {
@@ -366,36 +649,119 @@ bool SatSolver::update_watchlist(Watchlist& watchlist, int neg_literal, std::vec
         }
     }
 
+    if (_propagator != nullptr && !propagate_custom(watchlist, neg_literal >> 1, state, update_implications))
+    {
+        for (auto const impl : update_implications)
+            state[impl] = -1;
+        return false;
+    }
+
     for (auto const impl : update_implications)
         implications.push_back(impl);
     return true;
 }
 
+bool SatSolver::propagate_custom(Watchlist& watchlist, int var, std::vector<int>& state, std::vector<int>& implications)
+{
+    auto const first = _implied.size();
+    if (!_propagator->propagate(state, state[var] == 1 ? var : -var, _implied))
+    {
+        _implied.resize(first);
+        _stats.conflicts++;
+        return false;
+    }
+
+    // Nested calls push after last and pop what they pushed, so indices stay valid
+    auto const last = _implied.size();
+    for (auto k = first; k < last; k++)
+    {
+        auto const literal = _implied[k];
+        auto const variable = abs(literal);
+        int const value = literal > 0 ? 1 : 0;
+        if (state[variable] == value)
+            continue;
+        if (state[variable] != -1)
+        {
+            _implied.resize(first);
+            _stats.conflicts++;
+            return false;
+        }
+
+#ifdef DEBUG
+        auto const reason = _propagator->explain(state, literal);
+        assert(std::find(reason.begin(), reason.end(), literal) != reason.end() && "Reason must hold the implied literal");
+        for (auto const other : reason)
+            assert((other == literal || state[abs(other)] == (other > 0 ? 0 : 1)) && "Reason literals must be false");
+#endif
+
+        _stats.propagations++;
+        _stats.custom_propagations++;
+        state[variable] = value;
+        implications.push_back(variable);
+        if (!update_watchlist(watchlist, (variable << 1) | value, state, implications))
+        {
+            _implied.resize(first);
+            return false;
+        }
+    }
+
+    _implied.resize(first);
+    return true;
+}
+
 bool SatSolver::solve_by_watchlist(Watchlist& watchlist, std::vector<int>& state, const std::vector<Variable>& variables, const std::vector<size_t>& positive_reps, const std::vector<size_t>& negative_reps, size_t next_var_index)
 {
+    // if already set, maybe due to an implication, just skip
+    while (next_var_index < variables.size() && state[variables[next_var_index]] != -1)
+        next_var_index++;
     if (next_var_index == variables.size())
-        return true;
+        return _on_model == nullptr || report_model(state);
 
-    auto const next_var = variables[next_var_index];
-    if(state[next_var] != -1) // if already set, maybe due to an implication, just skip
-        return solve_by_watchlist(watchlist, state, variables, positive_reps, negative_reps, next_var_index + 1);
+    // The propagator may know a better decision than the fixed order. Then the fixed order resumes where it was
+    auto const decision = _propagator != nullptr ? _propagator->decide(state, _phase) : 0;
+    auto const next_var = decision != 0 ? abs(decision) : variables[next_var_index];
+    auto const next_index = decision != 0 ? next_var_index : next_var_index + 1;
+
+    if (!check_memory())
+        return false;
 
     bool result = false;
     size_t n_tries = 2;
-    // first try to true if variable occurs positive most of the time, or 0 otherwise
+    // first try to true if variable occurs positive most of the time, or 0 otherwise.
+    // If we have a phase for this variable, it takes precedence
     int i = positive_reps[next_var] > negative_reps[next_var] ? 1 : 0;
+    if (!_phase.empty() && _phase[next_var] != -1)
+        i = _phase[next_var];
+    if (decision != 0)
+        i = decision > 0 ? 1 : 0;
     while(n_tries)
     {
         state[next_var] = i;
+        on_decision();
         std::vector<int> implications;
         if (update_watchlist(watchlist, (next_var << 1) | i, state, implications))
         {
-            result = solve_by_watchlist(watchlist, state, variables, positive_reps, negative_reps, next_var_index+1);
+            auto const frame_bytes = sizeof(implications) + implications.capacity() * sizeof(int);
+            _memory.trail += frame_bytes;
+            _depth++;
+            result = solve_by_watchlist(watchlist, state, variables, positive_reps, negative_reps, next_index);
+            _depth--;
+            _memory.trail -= frame_bytes;
             if (result) break;
         }
 
         for(auto const var : implications)
             state[var] = -1;
+        if (_limit_reached)
+            break;
+        // After a model, the search goes on from the deepest projected decision, the deepest level where a clause
+        // blocking that model isn't falsified. Other values of the variables below it would only repeat the model
+        if (_backtrack_to_projected)
+        {
+            if (static_cast<size_t>(next_var) > _n_projected)
+                break;
+            _backtrack_to_projected = false;
+        }
         n_tries--;
         i = i ^ 1;
     }
@@ -403,10 +769,246 @@ bool SatSolver::solve_by_watchlist(Watchlist& watchlist, std::vector<int>& state
     if (result)
         return true;
 
+    _stats.backtracks++;
     state[next_var] = -1;
     return false;
 }
 
+int SatSolver::look_ahead(Watchlist& watchlist, std::vector<int>& state, Variable var, int value, bool double_look_ahead)
+{
+    _stats.look_aheads++;
+    state[var] = value;
+    std::vector<int> implications;
+    int diff = -1;
+    if (update_watchlist(watchlist, (var << 1) | value, state, implications))
+    {
+        diff = 1 + static_cast<int>(implications.size());
+
+        // Double look ahead: if this assignment reduced a lot, check if it leads to a failed 
+        // literal one level deeper, that is, a variable that fails for both values
+        if (double_look_ahead && static_cast<size_t>(diff) >= _double_look_ahead_threshold)
+        {
+            size_t n_checked = 0;
+            for (size_t i = 0; i < _sorted_variables.size() && n_checked < _double_look_ahead_candidates; i++)
+            {
+                auto const next_var = _sorted_variables[i];
+                if (state[next_var] != -1)
+                    continue;
+                n_checked++;
+                if (look_ahead(watchlist, state, next_var, 1, false) == -1 && look_ahead(watchlist, state, next_var, 0, false) == -1)
+                {
+                    diff = -1;
+                    break;
+                }
+            }
+        }
+    }
+
+    for(auto const implied_var : implications)
+        state[implied_var] = -1;
+    state[var] = -1;
+
+    return diff;
+}
+
+bool SatSolver::look_ahead_scores(Watchlist& watchlist, std::vector<int>& state, std::vector<std::pair<long long, Variable>>& scores, std::vector<int>& out_forced, std::vector<int>& out_preferred_value)
+{
+    // Candidates are the first free variables in the occurrence order
+    std::vector<Variable> candidates;
+    for (size_t i = 0; i < _sorted_variables.size() && candidates.size() < _look_ahead_candidates; i++)
+        if (state[_sorted_variables[i]] == -1)
+            candidates.push_back(_sorted_variables[i]);
+
+    for (auto const var : candidates)
+    {
+        if (state[var] != -1) // Forced by a failed literal found earlier in this loop
+            continue;
+
+        auto const diff_true = look_ahead(watchlist, state, var, 1, true);
+        auto const diff_false = look_ahead(watchlist, state, var, 0, true);
+
+        if (diff_true == -1 && diff_false == -1)
+            return false;
+
+        if (diff_true == -1 || diff_false == -1)
+        {
+            // Failed literal: the other value is forced 
+            auto const forced = diff_true == -1 ? 0 : 1;
+            state[var] = forced;
+            out_forced.push_back(var);
+            if (!update_watchlist(watchlist, (var << 1) | forced, state, out_forced))
+                return false;
+            continue;
+        }
+
+        // March-like score: favour variables that reduce a lot in both branches
+        auto const score = 1024LL * diff_true * diff_false + diff_true + diff_false;
+        scores.emplace_back(score, var);
+        // Branch first on the value that reduces less, it's more likely to be satisfiable
+        out_preferred_value[var] = diff_true <= diff_false ? 1 : 0;
+    }
+
+    return true;
+}
+
+bool SatSolver::solve_by_lookahead(Watchlist& watchlist, std::vector<int>& state)
+{
+    if (!check_memory())
+        return false;
+
+    std::vector<std::pair<long long, Variable>> scores;
+    std::vector<int> forced;
+    std::vector<int> preferred_value(_n_variables + 1, -1);
+
+    auto undo = [&state](const std::vector<int>& vars) { for(auto const var : vars) state[var] = -1; };
+
+    if (!look_ahead_scores(watchlist, state, scores, forced, preferred_value))
+    {
+        undo(forced);
+        return false;
+    }
+
+    if (scores.empty())
+    {
+        // No candidates left, but there might still be free variables we didn't consider
+        auto const next = std::find_if(_sorted_variables.begin(), _sorted_variables.end(), [&state](Variable var) { return state[var] == -1; });
+        if (next == _sorted_variables.end())
+            return true;
+        scores.emplace_back(0, *next);
+        preferred_value[*next] = _positive_repetitions[*next] > _negative_repetitions[*next] ? 1 : 0;
+    }
+
+    auto const next_var = std::max_element(scores.begin(), scores.end())->second;
+    int value = preferred_value[next_var];
+    if (!_phase.empty() && _phase[next_var] != -1)
+        value = _phase[next_var];
+
+    // Scores, forced variables and preferred values live as long as this frame
+    auto const frame_bytes = sizeof(int) * (forced.capacity() + preferred_value.capacity()) + scores.capacity() * sizeof(scores[0]);
+    _memory.trail += frame_bytes;
+    for (size_t n_tries = 0; n_tries < 2 && !_limit_reached; n_tries++, value ^= 1)
+    {
+        state[next_var] = value;
+        on_decision();
+        std::vector<int> implications;
+        _depth++;
+        auto const result = update_watchlist(watchlist, (next_var << 1) | value, state, implications) && solve_by_lookahead(watchlist, state);
+        _depth--;
+        if (result)
+        {
+            _memory.trail -= frame_bytes;
+            return true;
+        }
+
+        undo(implications);
+    }
+    _memory.trail -= frame_bytes;
+    _stats.backtracks++;
+
+    state[next_var] = -1;
+    undo(forced);
+    return false;
+}
+
+SatTreeEstimate SatSolver::estimate_tree_size(size_t n_probes)
+{
+    SatTreeEstimate estimate;
+    prepare();
+    if (_limit_reached || _clauses.empty())
+        return estimate;
+
+    std::mt19937 rng(_seed);
+    std::vector<int> state(_root_state);
+    auto watchlist = create_watchlist(state);
+
+    double sum = 0, sum_squares = 0;
+    size_t total_levels = 0;
+    auto const probes_start = std::chrono::high_resolution_clock::now();
+    std::vector<int> assigned;
+    std::vector<int> implications;
+    for (size_t probe = 0; probe < n_probes; probe++)
+    {
+        // Walk down the same tree solve_by_watchlist explores, choosing a random feasible value at each level
+        double level_size = 1, tree_size = 1;
+        bool solution = true;
+        assigned.clear();
+        for (auto const var : _sorted_variables)
+        {
+            if (state[var] != -1)
+                continue;
+
+            int feasible[2];
+            size_t n_feasible = 0;
+            for (int value = 0; value < 2; value++)
+            {
+                state[var] = value;
+                implications.clear();
+                if (update_watchlist(watchlist, (var << 1) | value, state, implications))
+                    feasible[n_feasible++] = value;
+                for (auto const implied_var : implications)
+                    state[implied_var] = -1;
+            }
+            state[var] = -1;
+            total_levels++;
+
+            if (n_feasible == 0)
+            {
+                solution = false;
+                break;
+            }
+
+            level_size *= static_cast<double>(n_feasible);
+            tree_size += level_size;
+
+            auto const value = feasible[rng() % n_feasible];
+            state[var] = value;
+            assigned.push_back(var);
+            update_watchlist(watchlist, (var << 1) | value, state, assigned);
+        }
+
+        for (auto const var : assigned)
+            state[var] = -1;
+
+        estimate.solutions += static_cast<size_t>(solution);
+        sum += tree_size;
+        sum_squares += tree_size * tree_size;
+    }
+    auto const probes_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - probes_start).count();
+
+    estimate.probes = n_probes;
+    if (n_probes == 0)
+        return estimate;
+
+    auto const n = static_cast<double>(n_probes);
+    estimate.nodes = sum / n;
+    estimate.nodes_error = n_probes > 1 ? std::sqrt(std::max(0.0, sum_squares / n - estimate.nodes * estimate.nodes) / (n - 1)) : 0;
+    // Each probe level does roughly the same work as a search node: propagate both values of a variable
+    if (total_levels > 0)
+        estimate.seconds = estimate.nodes * probes_seconds / static_cast<double>(total_levels);
+
+    return estimate;
+}
+
+std::vector<Variable> SatSolver::lookahead_split_variables(size_t count)
+{
+    prepare();
+    std::vector<int> state(_root_state);
+    auto watchlist = create_watchlist(state);
+
+    std::vector<std::pair<long long, Variable>> scores;
+    std::vector<int> forced;
+    std::vector<int> preferred_value(_n_variables + 1, -1);
+    std::vector<Variable> split_variables;
+    if (!look_ahead_scores(watchlist, state, scores, forced, preferred_value))
+        return split_variables;
+
+    std::sort(scores.begin(), scores.end(), std::greater<std::pair<long long, Variable>>());
+    for (size_t i = 0; i < scores.size() && i < count; i++)
+        split_variables.push_back(scores[i].second);
+
+    return split_variables;
+}
+
 bool SatSolver::solve_by_watchlist_iter(Watchlist& watchlist, std::vector<int>& state, const std::vector<Variable>& variables,  const std::vector<size_t>& positive_reps, const std::vector<size_t>& negative_reps, size_t next_var_index)
 {   
     auto const n = _n_variables;
@@ -456,6 +1058,188 @@ bool SatSolver::solve_by_watchlist_iter(Watchlist& watchlist, std::vector<int>&
     
 }
 
+bool SatSolver::local_search(const std::vector<int>& state, std::vector<int>& best_state)
+{
+    // ProbSAT: pick a random unsatisfied clause, and flip one of its variables with 
+    // probability proportional to (eps + break)^-cb, where break is the number of clauses
+    // that would become unsatisfied by flipping that variable. 
+    std::mt19937 rng(_seed);
+    auto const n_literals = 2 * (_n_variables + 1);
+
+    // Occurrences of each literal 
+    std::vector<std::vector<size_t>> occurrences(n_literals);
+    size_t max_clause_size = 0;
+    for(size_t i = 0; i < _clauses.size(); i++)
+    {
+        for(auto const literal : _clauses[i])
+            occurrences[literal].push_back(i);
+        max_clause_size = std::max(max_clause_size, _clauses[i].size());
+    }
+
+    // Polynomial break-only ProbSAT parameters, cb grows with clause size
+    double const eps = 0.9;
+    double const cb = max_clause_size <= 3 ? 2.06 : max_clause_size <= 4 ? 3.0 : max_clause_size <= 5 ? 3.7 : 5.4;
+    std::vector<double> break_score(64);
+    for(size_t i = 0; i < break_score.size(); i++)
+        break_score[i] = std::pow(eps + static_cast<double>(i), -cb);
+
+    // Initial assignment: fixed variables keep their value, free variables start random
+    std::vector<int> assignment(state);
+    for(size_t var = 1; var <= _n_variables; var++)
+        if (state[var] == -1)
+            assignment[var] = static_cast<int>(rng() & 1);
+
+    auto literal_is_true = [&assignment](int literal) { return assignment[literal_to_variable(literal)] == ((literal & 1) ^ 1); };
+
+    // Per clause number of true literals, and xor of their variables. 
+    // When a clause has exactly one true literal, the xor is its only critical variable
+    std::vector<size_t> true_count(_clauses.size(), 0);
+    std::vector<int> true_xor(_clauses.size(), 0);
+    std::vector<size_t> break_count(_n_variables + 1, 0);
+    std::vector<size_t> unsat_clauses;
+    std::vector<size_t> unsat_position(_clauses.size(), 0);
+
+    // Occurrence lists and per clause counters are released when local search is done
+    auto const local_search_bytes = watchlist_bytes(occurrences) + _clauses.size() * (3 * sizeof(size_t) + sizeof(int)) + 2 * assignment.capacity() * sizeof(int);
+    _memory.watches += local_search_bytes;
+    if (!check_memory())
+    {
+        _memory.watches -= local_search_bytes;
+        best_state = assignment;
+        return false;
+    }
+
+    for(size_t i = 0; i < _clauses.size(); i++)
+    {
+        for(auto const literal : _clauses[i])
+            if (literal_is_true(literal))
+            {
+                true_count[i]++;
+                true_xor[i] ^= literal_to_variable(literal);
+            }
+
+        if (true_count[i] == 0)
+        {
+            unsat_position[i] = unsat_clauses.size();
+            unsat_clauses.push_back(i);
+        }
+        else if (true_count[i] == 1)
+            break_count[true_xor[i]]++;
+    }
+
+    best_state = assignment;
+    size_t best_unsat = unsat_clauses.size();
+    std::vector<double> probabilities;
+
+    for(size_t flip = 0; flip < _max_flips && !unsat_clauses.empty(); flip++)
+    {
+        auto const& clause = _clauses[unsat_clauses[rng() % unsat_clauses.size()]];
+
+        // Choose variable to flip
+        probabilities.clear();
+        double total = 0;
+        for(auto const literal : clause)
+        {
+            auto const breaks = std::min(break_count[literal_to_variable(literal)], break_score.size() - 1);
+            total += break_score[breaks];
+            probabilities.push_back(total);
+        }
+        double const pick = std::uniform_real_distribution<double>(0, total)(rng);
+        size_t chosen = 0;
+        while (chosen + 1 < clause.size() && probabilities[chosen] < pick)
+            chosen++;
+
+        auto const var = literal_to_variable(clause[chosen]);
+        assignment[var] ^= 1;
+        _stats.flips++;
+
+        // Literal that just became true, and the one that just became false
+        auto const true_literal = (var << 1) | (assignment[var] ^ 1);
+        auto const false_literal = true_literal ^ 1;
+
+        for(auto const clause_index : occurrences[true_literal])
+        {
+            true_count[clause_index]++;
+            true_xor[clause_index] ^= var;
+            if (true_count[clause_index] == 1) // was unsat, now var is critical for it
+            {
+                auto const pos = unsat_position[clause_index];
+                unsat_clauses[pos] = unsat_clauses.back();
+                unsat_position[unsat_clauses[pos]] = pos;
+                unsat_clauses.pop_back();
+                break_count[var]++;
+            }
+            else if (true_count[clause_index] == 2) // previous critical variable is not critical anymore
+                break_count[true_xor[clause_index] ^ var]--;
+        }
+
+        for(auto const clause_index : occurrences[false_literal])
+        {
+            true_count[clause_index]--;
+            true_xor[clause_index] ^= var;
+            if (true_count[clause_index] == 0) // var was critical for this clause, now it's broken
+            {
+                unsat_position[clause_index] = unsat_clauses.size();
+                unsat_clauses.push_back(clause_index);
+                break_count[var]--;
+            }
+            else if (true_count[clause_index] == 1) // remaining true literal is now critical
+                break_count[true_xor[clause_index]]++;
+        }
+
+        if (unsat_clauses.size() < best_unsat)
+        {
+            best_unsat = unsat_clauses.size();
+            best_state = assignment;
+        }
+    }
+
+    _memory.watches -= local_search_bytes;
+    return best_unsat == 0;
+}
+
+void SatSolver::on_decision()
+{
+    _stats.decisions++;
+    if (_decision_limit != 0 && _stats.decisions > _decision_limit)
+        _limit_reached = true;
+    _stats.max_depth = std::max(_stats.max_depth, _depth + 1);
+    for(auto const& [hook, interval] : _hooks)
+        if (interval != 0 && _stats.decisions % interval == 0)
+        {
+            _stats.search_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - _search_start).count();
+            hook(*this);
+        }
+}
+
+bool SatSolver::check_memory()
+{
+    auto const total = _memory.total();
+    _memory.peak = std::max(_memory.peak, total);
+    if (_mem_limit != 0 && total > _mem_limit)
+        _limit_reached = true;
+
+    return !_limit_reached;
+}
+
+size_t SatSolver::clauses_bytes(const std::vector<Clause>& clauses)
+{
+    size_t bytes = clauses.capacity() * sizeof(Clause);
+    for(auto const& clause : clauses)
+        bytes += clause.capacity() * sizeof(Variable);
+
+    return bytes;
+}
+
+size_t SatSolver::watchlist_bytes(const Watchlist& watchlist)
+{
+    size_t bytes = watchlist.capacity() * sizeof(std::vector<size_t>);
+    for(auto const& watches : watchlist)
+        bytes += watches.capacity() * sizeof(size_t);
+
+    return bytes;
+}
+
 void SatSolver::reduce_unit_clauses(std::vector<Clause>& clauses, std::vector<int>& state)
 {
     bool change = true;
@@ -509,6 +1293,7 @@ void SatSolver::constant_reduction(std::vector<Clause>& clauses, std::vector<int
     for(auto const& clause : clauses)
     {
         next_clause.clear();
+        bool satisfied = false;
 
         for(auto const var : clause)
         {
@@ -518,7 +1303,7 @@ void SatSolver::constant_reduction(std::vector<Clause>& clauses, std::vector<int
             // If 1, this clause adds nothing
             if ((var_state == 1 && var > 0) || (var_state == 0 && var < 0)) // only add variable to clause if not constant
             {
-                next_clause.clear();
+                satisfied = true;
                 break;
             }
             else if ((var_state == 1 && var < 0) || (var_state == 0 && var > 0)) // if variable evals to false, then don't add it to the clause
@@ -531,7 +1316,8 @@ void SatSolver::constant_reduction(std::vector<Clause>& clauses, std::vector<int
             }
         }
 
-        if (!next_clause.empty())
+        // If every variable evals to false, keep the empty clause: the expression can't be satisfied
+        if (!satisfied)
             new_clauses.emplace_back(next_clause);
     }
     clauses = new_clauses;
@@ -3,11 +3,13 @@
 
 #include <string>
 #include <vector>
-#include "SatSudoku.hpp"
 #include <iostream>
 #include <queue>
 #include <map>
+#include <functional>
+#include <chrono>
 #include <assert.h>
+#include "ClauseSink.hpp"
 
 #ifndef STATUS
     #define SUCCESS 1
@@ -15,9 +17,6 @@
     #define STATUS int
 #endif
 
-using Variable = int;
-using Clause = std::vector<Variable>;
-
 enum SatSatisfiable
 {
     SATISFIABLE = 1,
@@ -31,6 +30,83 @@ enum SATFormat
     CNF
 };
 
+/// Search strategies available to the SatSolver
+enum SolverStrategy
+{
+    /// Systematic backtracking over the watchlist (default)
+    WATCHLIST,
+    /// ProbSAT-style stochastic local search. Incomplete: it can't prove unsatisfiability
+    LOCAL_SEARCH,
+    /// Run local search first, and seed the watchlist search polarities with its best assignment
+    HYBRID,
+    /// March-like search: each decision is chosen by trial propagation of candidate variables
+    LOOKAHEAD
+};
+
+
+/// @brief Memory used by a SatSolver, in bytes
+struct SatMemoryUsage
+{
+    /// @brief Clause storage
+    size_t clauses = 0;
+    /// @brief Watchlists and occurrence lists
+    size_t watches = 0;
+    /// @brief Variable state and implications recorded along the search path
+    size_t trail = 0;
+    /// @brief Max total memory seen so far
+    size_t peak = 0;
+
+    size_t total() const { return clauses + watches + trail; }
+};
+
+/// @brief Counters and timings collected by a SatSolver while solving
+struct SatSolverStats
+{
+    /// @brief Number of values tried for branching variables
+    size_t decisions = 0;
+    /// @brief Number of variables assigned by unit propagation
+    size_t propagations = 0;
+    /// @brief Number of those assigned by a custom propagator
+    size_t custom_propagations = 0;
+    /// @brief Number of times propagation found a clause that can't be satisfied
+    size_t conflicts = 0;
+    /// @brief Number of times a branching variable was unassigned after trying all its values
+    size_t backtracks = 0;
+    /// @brief Number of trial propagations done by lookahead
+    size_t look_aheads = 0;
+    /// @brief Number of flips done by local search
+    size_t flips = 0;
+    /// @brief Max number of nested decisions
+    size_t max_depth = 0;
+    /// @brief Time spent in each phase, in milliseconds
+    double preprocess_ms = 0;
+    double local_search_ms = 0;
+    double search_ms = 0;
+
+    /// @brief Human readable representation, fits in a single line
+    std::string as_str() const;
+
+    /// @brief Machine readable representation, as a single line json object
+    std::string as_json() const;
+};
+
+/// @brief Estimate of the size of the search tree explored by the watchlist search
+struct SatTreeEstimate
+{
+    /// @brief Number of random probes used for this estimate
+    size_t probes = 0;
+    /// @brief Estimated number of nodes in the search tree
+    double nodes = 0;
+    /// @brief Standard error of the nodes estimate
+    double nodes_error = 0;
+    /// @brief Estimated time to explore the whole tree, in seconds 
+    double seconds = 0;
+    /// @brief Number of probes that ended in a satisfying assignment
+    size_t solutions = 0;
+
+    /// @brief Single line representation, as key=value pairs
+    std::string as_str() const;
+};
 
 /// @brief Output of a Sat solution
 struct SatSolution
@@ -50,12 +126,61 @@ struct SatSolution
 };
 
 
+/// @brief Custom propagation for constraints that are costly to write as clauses. The solver calls it on every
+/// assignment made during search, and treats the literals it implies like those implied by clauses
+class SatPropagator
+{
+    public:
+        virtual ~SatPropagator() = default;
+
+        /// @brief Called right after a literal becomes true, once clauses watching it were updated
+        /// @param state value of each variable: 1 true, 0 false, -1 unassigned. Index 0 is unused
+        /// @param literal literal that became true, in DIMACS format
+        /// @param implied Output: literals made true by this assignment, in DIMACS format. Literals already true are skipped
+        /// @return false if the current assignment breaks the constraints
+        virtual bool propagate(const std::vector<int>& state, Variable literal, std::vector<Variable>& implied) = 0;
+
+        /// @brief Reason for a literal implied by propagate, asked for only when needed. Debug builds check every
+        /// implication against it, a solver learning clauses would use it to analyze conflicts
+        /// @param state value of each variable, as in propagate. Still the one that implied literal
+        /// @param literal implied literal
+        /// @return a clause implied by the constraints that holds literal, with every other literal false in state
+        virtual Clause explain(const std::vector<int>& state, Variable literal) = 0;
+
+        /// @brief Pick the next decision of the watchlist search, which otherwise follows a fixed variable order 
+        /// and can get lost when most of the problem lives in the propagator
+        /// @param state value of each variable, as in propagate
+        /// @param phase preferred value of each variable set on the solver, as in SatSolver::set_phase. Empty if none
+        /// @return an unassigned literal to try true first, in DIMACS format, or 0 to use the fixed order
+        virtual Variable decide(const std::vector<int>& state, const std::vector<int>& phase) { return 0; }
+};
+
 /// @brief A SAT problem
-class SatSolver
+class SatSolver : public ClauseSink
 {
     public:
         SatSolver(const std::vector<Clause>& clauses, size_t n_variables, SATFormat format = SATFormat::CNF);
 
+        /// @brief Create a problem with no clauses, to be filled through add_clause
+        /// @param n_variables number of variables, can be changed with set_n_variables until solving
+        explicit SatSolver(size_t n_variables, SATFormat format = SATFormat::CNF);
+
+        /// @brief Add a clause to this problem. It can be called between calls to solve, keeping what preprocessing 
+        /// did, as long as pure literal elimination is turned off
+        /// @param clause clause in DIMACS format
+        void add_clause(const Clause& clause) override;
+
+        /// @brief Add several clauses given as a flat list of literals, each clause ended by a 0. Before solving they
+        /// go straight into the clause store, which grows once for all of them
+        /// @param literals first literal
+        /// @param n_literals number of literals, terminators included
+        void add_clauses(const Variable* literals, size_t n_literals) override;
+
+        /// @brief Set number of variables, for problems whose clauses were added one by one. Between calls to solve
+        /// it can only grow, and new variables start unassigned, to be used by clauses added afterwards
+        /// @param n_variables number of variables
+        void set_n_variables(size_t n_variables);
+
         /// @brief Create a SatSolver instance from a string representation as specified in 
         /// the project document
         /// @param sat_str string with an input SAT expression
@@ -74,18 +199,105 @@ class SatSolver
         /// @return a string with a valid SAT file
         std::string as_str() const;
 
+        /// @brief Write this problem in DIMACS format, as as_str does, without building the whole string first
+        /// @param out stream to write to
+        void write(std::ostream& out) const;
+
         /// @brief Try to reduce sat as much as possible using symlogic properties
         void simplify();
 
         /// @brief Try to solve the SAT problem
         /// @return A solution representing the valid solution
-        SatSolution solve();
+        SatSolution solve() { return solve(std::vector<Variable>()); }
+
+        /// @brief Try to solve the SAT problem with some literals fixed for this call only. Preprocessing is done 
+        /// once, so solving many times with different assumptions costs a search each
+        /// @param assumptions literals to hold true, in DIMACS format
+        /// @return A solution that satisfies the assumptions, UNSATISFIABLE if there's none
+        SatSolution solve(const std::vector<Variable>& assumptions);
+
+        /// @brief Report every model of the problem, told apart by the first n_projected variables only. After a 
+        /// model the search backtracks to its deepest decision on a projected variable instead of starting over, 
+        /// so nothing is searched twice and no blocking clause is needed. Always uses the watchlist strategy
+        /// @param n_projected models that agree on variables 1 to n_projected count as one
+        /// @param on_model called with each model, returns false to stop there
+        /// @param assumptions literals to hold true, as in solve
+        /// @return SATISFIABLE if on_model stopped the search, UNSATISFIABLE once there are no more models and 
+        /// UNKNOWN if a limit was reached
+        SatSolution enumerate(size_t n_projected, const std::function<bool(const SatSolution&)>& on_model, const std::vector<Variable>& assumptions = std::vector<Variable>());
 
         /// @brief Get expected value for this variable for it to be true. If negated, value is false, if not, is true
         /// @param var var to get value for
         /// @return expected value so that this variable evaluates to true
         static int expected_value(Variable var);
 
+        /// @brief Choose the search strategy used by solve
+        /// @param strategy strategy to use, WATCHLIST by default
+        void set_strategy(SolverStrategy strategy) { _strategy = strategy; }
+
+        /// @brief Set seed for every randomized component of the solver
+        /// @param seed seed to use
+        void set_seed(unsigned int seed) { _seed = seed; }
+
+        /// @brief Set max number of flips a local search run can perform before giving up
+        /// @param max_flips max number of flips 
+        void set_max_flips(size_t max_flips) { _max_flips = max_flips; }
+
+        /// @brief Set number of candidate variables evaluated by each lookahead step
+        /// @param candidates number of candidates
+        void set_look_ahead_candidates(size_t candidates) { _look_ahead_candidates = candidates; }
+
+        /// @brief Set a memory limit for this solver. When it's exceeded, solve stops and returns UNKNOWN. It's only
+        /// checked by solve and its preprocessing: reading a formula and copying it into the solver are counted, but 
+        /// can go over the limit before any check
+        /// @param bytes max number of bytes to use, 0 for no limit
+        void set_mem_limit(size_t bytes) { _mem_limit = bytes; }
+
+        /// @brief Set a limit on decisions for each call to solve. When it's exceeded, solve stops and returns UNKNOWN
+        /// @param decisions max number of decisions, 0 for no limit
+        void set_decision_limit(size_t decisions) { _decision_limit = decisions; }
+
+        /// @brief Set the value to try first for each variable when branching, e.g. a model of a similar problem
+        /// so the search goes straight back to it. Hybrid strategy replaces it with its local search model
+        /// @param phase 1 or 0 for each variable, -1 for no preference. Index 0 is unused, variables past its end 
+        /// have no preference. Empty to clear it
+        void set_phase(const std::vector<int>& phase);
+
+        /// @brief Get memory used by this solver, including peak usage
+        /// @return Memory usage for each component, in bytes
+        const SatMemoryUsage& get_memory_usage() const { return _memory; }
+
+        /// @brief Get statistics for the last call to solve
+        const SatSolverStats& get_stats() const { return _stats; }
+
+        /// @brief Add a function to be called periodically during search
+        /// @param hook function to call, receives this solver so it can query stats and memory
+        /// @param interval number of decisions between calls
+        void add_hook(std::function<void(const SatSolver&)> hook, size_t interval) { _hooks.emplace_back(hook, interval); }
+
+        /// @brief Turn pure literal elimination on or off, before the first call to solve. It keeps satisfiability
+        /// but not every model, so turn it off to enumerate models or add clauses between calls to solve
+        /// @param enable if pure literals should be eliminated, true by default
+        void set_pure_literal_elimination(bool enable) { _pure_literal_elimination = enable; }
+
+        /// @brief Add custom propagation to the search. Pure literal elimination is turned off, since it only
+        /// knows about clauses, and a local search model must get through the propagator before being accepted
+        /// @param propagator propagator to use, not owned. Must outlive every call to solve. nullptr to remove it
+        void set_propagator(SatPropagator* propagator) { _propagator = propagator; }
+
+        /// @brief Estimate size of the watchlist search tree with Knuth's method: random probes from the root
+        /// to a leaf, multiplying the number of feasible branches found at each level.
+        /// The tree explored by solve can be much smaller if the formula is satisfiable, as search stops at the first solution
+        /// @param n_probes number of probes to run
+        /// @return Estimate of tree size and time needed to explore it
+        SatTreeEstimate estimate_tree_size(size_t n_probes);
+
+        /// @brief Rank variables by lookahead score after preprocessing, useful to choose splitting 
+        /// variables for partitioned solving
+        /// @param count max number of variables to return 
+        /// @return up to count variables, best first. Empty if the formula is found unsatisfiable or has no free variables
+        std::vector<Variable> lookahead_split_variables(size_t count);
+
     private:
 
         // A list of lists of clause indices
@@ -126,12 +338,69 @@ class SatSolver
 
         static bool check_watchlist_invariant(const std::vector<int>& state, const Watchlist& watchlist);
 
-        bool update_watchlist(Watchlist& watchlist, int neg_literal, std::vector<int>& state, std::vector<int>& implications) const;
+        bool update_watchlist(Watchlist& watchlist, int neg_literal, std::vector<int>& state, std::vector<int>& implications);
+
+        /// @brief Tell the propagator about an assignment and apply what it implies, through the watchlist too
+        /// @param var variable just assigned
+        /// @param implications Output: variables assigned here, to be unassigned by the caller on conflict
+        /// @return false on conflict
+        bool propagate_custom(Watchlist& watchlist, int var, std::vector<int>& state, std::vector<int>& implications);
 
         bool solve_by_watchlist(Watchlist& watchlist, std::vector<int>& state, const std::vector<Variable>& variables, const std::vector<size_t>& positive_reps, const std::vector<size_t>& negative_reps, size_t next_var_index = 0);
 
+        /// @brief Turn a full assignment into a solution, unset variables as false
+        SatSolution build_solution(const std::vector<int>& state) const;
+
+        /// @brief Hand the model in state to the enumeration callback
+        /// @return true if the callback wants no more models
+        bool report_model(const std::vector<int>& state);
+
+        /// @brief Trial propagation: assign value to var, propagate, and undo everything
+        /// @param watchlist current watchlist 
+        /// @param state current state, left unchanged
+        /// @param var variable to try
+        /// @param value value to try for var
+        /// @param double_look_ahead if should also look for failed literals one level deeper
+        /// @return number of variables assigned by this trial, or -1 if it leads to a conflict
+        int look_ahead(Watchlist& watchlist, std::vector<int>& state, Variable var, int value, bool double_look_ahead);
+
+        /// @brief Score candidate variables with lookahead, assigning failed literals as they're found
+        /// @param scores Output: score of each candidate that is still free
+        /// @param out_forced Output: variables assigned because of failed literals
+        /// @param out_preferred_value Output: value to try first for each scored variable
+        /// @return false if a conflict was found
+        bool look_ahead_scores(Watchlist& watchlist, std::vector<int>& state, std::vector<std::pair<long long, Variable>>& scores, std::vector<int>& out_forced, std::vector<int>& out_preferred_value);
+
+        bool solve_by_lookahead(Watchlist& watchlist, std::vector<int>& state);
+
         bool solve_by_watchlist_iter(Watchlist& watchlist, std::vector<int>& state, const std::vector<Variable>& variables, const std::vector<size_t>& positive_reps, const std::vector<size_t>& negative_reps,size_t next_var_index = 0 );
 
+        /// @brief Run a ProbSAT local search over the free variables in state. Clauses should be in literal format.
+        /// @param state state of variables, only unassigned variables (-1) are flipped. 
+        /// @param best_state Output: the assignment with fewest unsatisfied clauses found, a full assignment 
+        /// @return If a satisfying assignment was found 
+        bool local_search(const std::vector<int>& state, std::vector<int>& best_state);
+
+        /// @brief Preprocess clauses and compute variable ordering, only the first time it's called.
+        /// After this, clauses are in literal format
+        void prepare();
+
+        /// @brief Count a new decision at the current depth, and run hooks if it's their time
+        void on_decision();
+
+        /// @brief Update peak memory usage and check it against the memory limit
+        /// @return false if memory or decision limit was exceeded. In that case, the search must stop
+        bool check_memory();
+
+        /// @brief Append a clause to _clauses, accounting for the memory it takes
+        void store_clause(Clause&& clause);
+
+        /// @brief Bytes used by a list of clauses
+        static size_t clauses_bytes(const std::vector<Clause>& clauses);
+
+        /// @brief Bytes used by a watchlist
+        static size_t watchlist_bytes(const Watchlist& watchlist);
+
         static void reduce_unit_clauses(std::vector<Clause>& clauses, std::vector<int>& state);
 
         /// @brief Assign constant value to all variables that show up always possitive, or always negated, and simplify expression
@@ -156,6 +425,49 @@ class SatSolver
         SATFormat _format;
         std::vector<Clause> _clauses;
         std::vector<int> _literals;
+
+        SolverStrategy _strategy = SolverStrategy::WATCHLIST;
+        unsigned int _seed = 42;
+        size_t _max_flips = 1000000;
+
+        // Preferred value for each variable when branching, -1 if no preference. 
+        // Filled by local search in hybrid mode or by set_phase
+        std::vector<int> _phase;
+
+        size_t _look_ahead_candidates = 32;
+        size_t _double_look_ahead_candidates = 8;
+        size_t _double_look_ahead_threshold = 16;
+
+        // Memory accounting and limits. Reaching any limit stops the search
+        SatMemoryUsage _memory;
+        size_t _mem_limit = 0;
+        size_t _decision_limit = 0;
+        bool _limit_reached = false;
+
+        // Statistics and periodic hooks
+        SatSolverStats _stats;
+        size_t _depth = 0;
+        std::chrono::high_resolution_clock::time_point _search_start;
+        std::vector<std::pair<std::function<void(const SatSolver&)>, size_t>> _hooks;
+        SatPropagator* _propagator = nullptr;
+        // Literals implied by the propagator, shared by nested calls to propagate_custom. Each call reads its own 
+        // range at the end and drops it when done, so assignments don't allocate
+        std::vector<Variable> _implied;
+        bool _pure_literal_elimination = true;
+        // Model enumeration: callback for each model, how many variables tell models apart, and whether the search
+        // is going back to the deepest projected decision after reporting one
+        const std::function<bool(const SatSolution&)>* _on_model = nullptr;
+        size_t _n_projected = 0;
+        bool _backtrack_to_projected = false;
+
+        // Search data computed by prepare
+        bool _prepared = false;
+        // If preprocessing found the expression to be unsatisfiable
+        bool _unsatisfiable = false;
+        std::vector<int> _root_state;
+        std::vector<Variable> _sorted_variables;
+        std::vector<size_t> _positive_repetitions;
+        std::vector<size_t> _negative_repetitions;
 };
 
 #endif
\ No newline at end of file
@@ -9,13 +9,25 @@
 #include <chrono>
 #include <thread>
 #include <future>
+#include <memory>
 #include "Colors.hpp"
+#include "DlxSolver.hpp"
+#include "BitboardSolver.hpp"
+#include "SudokuPropagator.hpp"
+#include "SolutionCache.hpp"
 
-SatSudoku::SatSudoku(float max_time, const std::string& file, bool file_is_sudoku, bool dump_sat)
+SatSudoku::SatSudoku(float max_time, const std::string& file, bool file_is_sudoku, bool dump_sat, bool propagate, const EncodingOptions& encoding, SolverBackend backend, bool count, size_t count_limit, size_t cache_entries, const std::string& cache_file)
     : _file(file)
     , _time(max_time)
     , _file_is_sudoku(file_is_sudoku)
     , _dump_sat(dump_sat)
+    , _propagate(propagate)
+    , _encoding(encoding)
+    , _backend(backend)
+    , _count(count)
+    , _count_limit(count_limit)
+    , _cache_entries(cache_entries)
+    , _cache_file(cache_file)
 { }
 
 void SatSudoku::run()
@@ -39,13 +51,115 @@ void SatSudoku::run()
         run_sat_solver();
 }
 
-Sudoku SatSudoku::solve_sudoku(Sudoku& sudoku, bool dump_sat)
+Sudoku SatSudoku::solve_sudoku(Sudoku& sudoku, bool dump_sat, bool propagate, EncodingOptions encoding, SolverBackend backend)
 {
+    // Clashing givens are found in microseconds, don't bother the solver with them
+    auto const conflicts = sudoku.find_conflicts();
+    if (!conflicts.empty())
+    {
+        for (auto const& conflict : conflicts)
+            std::cout << RED << "Invalid sudoku: " << conflict.as_str() << RESET << std::endl;
+        std::cout << RED << "Sudoku has no solution  T.T" << RESET << std::endl;
+        return sudoku;
+    }
+
     // Time each step in this function
+    if (propagate)
+    {
+        std::cout << "Propagating sudoku..." << std::endl;
+        auto propagate_start = std::chrono::high_resolution_clock::now();
+        auto const propagation = sudoku.propagate();
+        auto propagate_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - propagate_start);
+        std::cout << "Propagation done in " << YELLOW << propagate_duration.count() << " us\n" << RESET;
+
+        if (propagation == PropagationResult::SOLVED)
+        {
+            std::cout << GREEN << "Sudoku solved by propagation!" << RESET << std::endl;
+            return sudoku;
+        }
+        if (propagation == PropagationResult::CONTRADICTION)
+        {
+            std::cout << RED << "Sudoku has no solution  T.T" << RESET << std::endl;
+            return sudoku;
+        }
+    }
+
+    if (backend == SolverBackend::DLX)
+    {
+        std::cout << "Solving sudoku with dancing links..." << std::endl;
+        auto dlx_start = std::chrono::high_resolution_clock::now();
+        DlxSolver dlx(sudoku);
+        auto solution = dlx.solve();
+        auto dlx_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - dlx_start);
+        std::cout << "DLX done in " << YELLOW << dlx_duration.count() << " us" << RESET << ", " << dlx.get_nodes() << " nodes\n";
+
+        if (solution.satisfiable != SatSatisfiable::SATISFIABLE)
+        {
+            std::cout << RED << "Sudoku has no solution  T.T" << RESET << std::endl;
+            return sudoku;
+        }
+
+        std::cout << GREEN << "Sudoku has solution!" << RESET << std::endl;
+        sudoku.add_sat_solution(solution);
+        return sudoku;
+    }
+
+    if (backend == SolverBackend::BITBOARD && sudoku.get_order() != 3)
+        std::cout << YELLOW << "Bitboard backend only solves order 3 sudokus, using SAT" << RESET << std::endl;
+    else if (backend == SolverBackend::BITBOARD)
+    {
+        std::cout << "Solving sudoku with bitboards (" << BitboardSolver::instruction_set() << ")..." << std::endl;
+        auto bitboard_start = std::chrono::high_resolution_clock::now();
+        BitboardSolver bitboard;
+        auto solution = bitboard.solve(sudoku);
+        auto bitboard_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - bitboard_start);
+        std::cout << "Bitboard done in " << YELLOW << bitboard_duration.count() << " us" << RESET << ", " << bitboard.get_guesses() << " guesses\n";
+
+        if (solution.satisfiable != SatSatisfiable::SATISFIABLE)
+        {
+            std::cout << RED << "Sudoku has no solution  T.T" << RESET << std::endl;
+            return sudoku;
+        }
+
+        std::cout << GREEN << "Sudoku has solution!" << RESET << std::endl;
+        sudoku.add_sat_solution(solution);
+        return sudoku;
+    }
+
+    // The all different propagator doesn't need validity clauses at all
+    if (encoding.all_different)
+        encoding.lazy = false;
+
+    if (encoding.lazy)
+    {
+        std::cout << "Solving sudoku with lazy validity clauses..." << std::endl;
+        auto lazy_start = std::chrono::high_resolution_clock::now();
+        auto solution = solve_lazily(sudoku, encoding);
+        auto lazy_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - lazy_start);
+        std::cout << "Lazy solving done in " << YELLOW << lazy_duration.count() << " ms\n" << RESET;
+
+        if (solution.satisfiable != SatSatisfiable::SATISFIABLE)
+        {
+            std::cout << RED << (solution.satisfiable == SatSatisfiable::UNSATISFIABLE ? "Sudoku has no solution  T.T" : "Unable to find a solution for this sudoku") << RESET << std::endl;
+            return sudoku;
+        }
+
+        std::cout << GREEN << "Sudoku has solution!" << RESET << std::endl;
+        sudoku.add_sat_solution(solution);
+        return sudoku;
+    }
+
     std::cout << "Converting from sudoku to sat..." << std::endl;
     auto solve_start = std::chrono::high_resolution_clock::now();
-    SatSolver sat = sudoku.as_sat();
+    SatSolver sat = sudoku.as_sat(encoding);
     sat.simplify();
+    // Built from the variable map, which as_sat just made
+    SudokuPropagator all_different(sudoku);
+    if (encoding.all_different)
+    {
+        std::cout << "Rows, columns and regions are left to the all different propagator" << std::endl;
+        sat.set_propagator(&all_different);
+    }
     if (dump_sat)
     {
         std::string filename = "sudoku_sat_dump.sat";
@@ -86,6 +200,34 @@ Sudoku SatSudoku::solve_sudoku(Sudoku& sudoku, bool dump_sat)
     return sudoku;
 }
 
+SatSolution SatSudoku::solve_lazily(Sudoku& sudoku, const EncodingOptions& encoding)
+{
+    SatSolver sat(0);
+    auto n_variables = sudoku.encode(sat, encoding);
+    sat.set_n_variables(n_variables);
+    // Clauses keep coming between rounds, so nothing can be eliminated for good
+    sat.set_pure_literal_elimination(false);
+    // Early formulas leave most of the grid unconstrained, where local search finds models much faster
+    sat.set_strategy(SolverStrategy::HYBRID);
+
+    for (size_t round = 1; ; round++)
+    {
+        auto solution = sat.solve();
+        if (solution.satisfiable != SatSatisfiable::SATISFIABLE)
+            return solution;
+
+        // New groups may bring auxiliary variables, which the solver must know before their clauses arrive
+        ClauseBuffer violated;
+        auto const added = sudoku.add_violated_clauses(solution, violated, encoding, n_variables);
+        std::cout << "Round " << round << ": " << violated.clauses.size() << " clauses added, " << added << " groups violated" << std::endl;
+        if (added == 0)
+            return solution;
+        sat.set_n_variables(n_variables);
+        for (auto const& clause : violated.clauses)
+            sat.add_clause(clause);
+    }
+}
+
 void SatSudoku::run_sudoku_solver()
 {
     std::ifstream fs(_file);
@@ -93,6 +235,10 @@ void SatSudoku::run_sudoku_solver()
     // Just a line counter for debug
     size_t n_lines = 0;
     std::cout << "Processing file: " << _file << std::endl;
+    // Counting needs every solution, a cached one is of no use there
+    std::unique_ptr<SolutionCache> cache;
+    if (_cache_entries > 0 && !_count)
+        cache = std::make_unique<SolutionCache>(_cache_entries, _cache_file);
     while(std::getline(fs, line)) // Iterate over each sudoku line in file
     {
         n_lines++;
@@ -100,8 +246,13 @@ void SatSudoku::run_sudoku_solver()
 
         std::stringstream ss(line);
         size_t sudoku_order = 0;
-        // Parse sudoku order
+        // Parse sudoku order. Candidate masks hold a bit per digit, which limits it to 8
         ss >> sudoku_order;
+        if (!ss || sudoku_order == 0 || sudoku_order * sudoku_order > 8 * sizeof(CandidateMask))
+        {
+            std::cerr << "Skipping line " << n_lines << ": invalid sudoku order. Orders 1 to 8 are supported\n";
+            continue;
+        }
         std::string next_num_str;
 
         // Create sudoku with specified size
@@ -131,12 +282,21 @@ void SatSudoku::run_sudoku_solver()
 
         // Show sudoku to be solved
         sudoku.display();
+        // Solvers propagate the sudoku in place, the cache is keyed by the sudoku as it was read
+        Sudoku const puzzle(sudoku);
         Sudoku solution(0);
-        if (_time == 0) // If time == 0, just solve it whenever it's ready
-            solution = solve_sudoku(sudoku, _dump_sat);
+        if (_count)
+        {
+            solution = sudoku;
+            count_solutions(solution, _propagate, _encoding, _count_limit);
+        }
+        else if (cache && cache->find(sudoku, solution))
+            std::cout << GREEN << "Solution found in cache" << RESET << std::endl;
+        else if (_time == 0) // If time == 0, just solve it whenever it's ready
+            solution = solve_sudoku(sudoku, _dump_sat, _propagate, _encoding, _backend);
         else // Otherwise, wait for the specified ammount of time
         {
-            std::future<Sudoku> solve_thread = std::async(SatSudoku::solve_sudoku, std::ref(sudoku), _dump_sat);
+            std::future<Sudoku> solve_thread = std::async(SatSudoku::solve_sudoku, std::ref(sudoku), _dump_sat, _propagate, _encoding, _backend);
             auto result_ready = solve_thread.wait_for(std::chrono::seconds( (int) _time));
             if (result_ready != std::future_status::ready)
             {
@@ -145,10 +305,25 @@ void SatSudoku::run_sudoku_solver()
             }
             solution = solve_thread.get();
         }
+
+        // Only full valid grids are worth keeping, a timed out or unsatisfiable run leaves something else
+        if (cache && solution.get_order() == sudoku.get_order() && solution.find_conflicts().empty())
+        {
+            auto const n2 = sudoku_order * sudoku_order;
+            bool full = true;
+            for (size_t c = 0; c < n2 * n2 && full; c++)
+                full = solution.get_board().get(c / n2, c % n2) != 0;
+            if (full)
+                cache->insert(puzzle, solution);
+        }
         
         std::cout << GREEN << "Resulting Sudoku: " << RESET << std::endl;
         solution.display();
     }
+
+    if (cache)
+        std::cout << "Solution cache: " << cache->get_hits() << " hits, " << cache->get_disk_hits() << " of them from disk, "
+                  << cache->get_misses() << " misses" << std::endl;
 }
 
 void SatSudoku::run_sat_solver()
@@ -173,7 +348,7 @@ void SatSudoku::run_sat_solver()
         solution = sat.solve();
     else // Otherwise, wait for the specified ammount of time
     {
-        std::future<SatSolution> solve_thread = std::async(&SatSolver::solve, &sat);
+        std::future<SatSolution> solve_thread = std::async([&sat]() { return sat.solve(); });
         auto result_ready = solve_thread.wait_for(std::chrono::seconds( (int) _time));
         if (result_ready != std::future_status::ready)
         {
@@ -192,3 +367,74 @@ void SatSudoku::run_sat_solver()
     std::cout << RED << "SAT has no solution T.T" << RESET << std::endl;
 
 }
+
+size_t SatSudoku::count_solutions(Sudoku& sudoku, bool propagate, EncodingOptions encoding, size_t limit)
+{
+    if (!sudoku.find_conflicts().empty())
+    {
+        std::cout << RED << "Invalid sudoku, it has no solutions" << RESET << std::endl;
+        return 0;
+    }
+
+    if (propagate)
+    {
+        // Whatever propagation deduces holds in every solution, so it doesn't change the count
+        auto const propagation = sudoku.propagate();
+        if (propagation != PropagationResult::PARTIAL)
+        {
+            auto const count = propagation == PropagationResult::SOLVED ? 1 : 0;
+            std::cout << GREEN << "Propagation leaves " << count << " solution" << (count == 1 ? "" : "s") << RESET << std::endl;
+            return count;
+        }
+    }
+
+    // A lazy formula has models that aren't sudokus, so rows, columns and regions go to the propagator instead
+    if (encoding.lazy || sudoku.get_order() >= 7)
+        encoding.all_different = true;
+    encoding.lazy = false;
+    // Symmetry breaking leaves solutions out on purpose
+    encoding.break_symmetries = false;
+
+    SatSolver sat = sudoku.as_sat(encoding);
+    sat.simplify();
+    sat.set_pure_literal_elimination(false);
+    SudokuPropagator all_different(sudoku);
+    if (encoding.all_different)
+        sat.set_propagator(&all_different);
+
+    // Only cell variables tell solutions apart, auxiliary ones may take many values for the same sudoku
+    auto const n_cell_variables = sudoku.get_n_variables();
+    Sudoku first_solution = sudoku;
+    size_t count = 0;
+    auto const count_start = std::chrono::high_resolution_clock::now();
+    auto solve_start = count_start;
+    auto const on_solution = [&](const SatSolution& solution)
+    {
+        auto const solve_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - solve_start);
+        count++;
+        std::cout << "Solution " << count << " found in " << YELLOW << solve_duration.count() << " us" << RESET << std::endl;
+        if (count == 1)
+            first_solution.add_sat_solution(solution);
+        solve_start = std::chrono::high_resolution_clock::now();
+        return limit == 0 || count < limit;
+    };
+
+    // The search goes on from each solution instead of starting over with it blocked
+    auto const result = sat.enumerate(n_cell_variables, on_solution);
+    auto const solve_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - solve_start);
+    if (result.satisfiable == SatSatisfiable::UNKNOWN)
+        std::cout << RED << "Solver gave up, count is a lower bound" << RESET << std::endl;
+    else if (result.satisfiable == SatSatisfiable::UNSATISFIABLE)
+        std::cout << "No more solutions, search took " << YELLOW << solve_duration.count() << " us" << RESET << std::endl;
+    auto count_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - count_start);
+
+    std::cout << GREEN << "Found " << count << " solution" << (count == 1 ? "" : "s") << RESET;
+    if (limit != 0 && count == limit)
+        std::cout << " (limit reached" << (limit == 2 ? ", not unique" : "") << ")";
+    else if (count == 1)
+        std::cout << ", it's unique";
+    std::cout << " in " << YELLOW << count_duration.count() << " ms" << RESET << std::endl;
+
+    sudoku = first_solution;
+    return count;
+}
@@ -12,11 +12,22 @@
 
 class Sudoku;
 
+/// @brief How --solveSudoku solves each sudoku
+enum class SolverBackend
+{
+    /// Encode to CNF and run the SAT solver
+    SAT,
+    /// Exact cover with dancing links, straight from the board
+    DLX,
+    /// Vectorized bitboard search, only for order 3. Other orders go through SAT
+    BITBOARD
+};
+
 /// @brief Maion class wrapping application flow
 class SatSudoku
 {
     public:
-        SatSudoku(float max_time, const std::string& file, bool file_is_sudoku = true, bool dump_sat = false);
+        SatSudoku(float max_time, const std::string& file, bool file_is_sudoku = true, bool dump_sat = false, bool propagate = true, const EncodingOptions& encoding = EncodingOptions(), SolverBackend backend = SolverBackend::SAT, bool count = false, size_t count_limit = 0, size_t cache_entries = 0, const std::string& cache_file = "");
 
         /// @brief Run application logic
         void run();
@@ -27,7 +38,24 @@ class SatSudoku
         /// back to sudoku
         /// @param sudoku sudoku to be solved
         /// @return a solved sudoku
-        static Sudoku solve_sudoku(Sudoku& sudoku, bool dump_sat = false);
+        static Sudoku solve_sudoku(Sudoku& sudoku, bool dump_sat = false, bool propagate = true, EncodingOptions encoding = EncodingOptions(), SolverBackend backend = SolverBackend::SAT);
+
+        /// @brief Solve a sudoku with a lazy encoding: solve without validity clauses, add the ones the model
+        /// breaks, and repeat until the model is a valid sudoku or the formula is unsatisfiable. The same solver
+        /// is used for every round, new clauses go in between calls to solve
+        /// @param sudoku sudoku to be solved
+        /// @param encoding options for the encoding, lazy is assumed
+        /// @return solution for the last formula, a valid sudoku if satisfiable
+        static SatSolution solve_lazily(Sudoku& sudoku, const EncodingOptions& encoding);
+
+        /// @brief Count solutions of a sudoku. A single search enumerates them over cell variables, going on from 
+        /// each solution found until there are no more or limit is reached
+        /// @param sudoku sudoku to count solutions for. Filled with the first solution, if any
+        /// @param propagate if sudoku should be propagated first
+        /// @param encoding options for the encoding. Lazy can't enumerate, all different takes its place
+        /// @param limit stop after this many solutions, 0 for no limit. 2 is enough to check uniqueness
+        /// @return number of solutions found
+        static size_t count_solutions(Sudoku& sudoku, bool propagate, EncodingOptions encoding, size_t limit);
 
         /// @brief Run a sudoku solving with the specified configuration
         void run_sudoku_solver();
@@ -41,6 +69,17 @@ class SatSudoku
         // If input file is a sudoku, otherwise it's a SAT file. True by default
         bool _file_is_sudoku;
         bool _dump_sat;
+        // If sudokus are propagated before turning them into SAT
+        bool _propagate;
+        EncodingOptions _encoding;
+        SolverBackend _backend;
+        // Count solutions instead of finding one, up to _count_limit if it's not 0
+        bool _count;
+        size_t _count_limit;
+        // Solutions kept in memory by the solution cache, 0 for no cache
+        size_t _cache_entries;
+        // File where the solution cache keeps every solution, empty for memory only
+        std::string _cache_file;
 
 };
 
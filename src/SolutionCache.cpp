@@ -0,0 +1,276 @@
+#include "SolutionCache.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// File layout: a header, then one record per entry: hash (8 bytes), order (4 bytes), then the cells of the
+// canonical puzzle and of its solution, one byte each
+static constexpr char file_magic[8] = {'S', 'U', 'D', 'O', 'C', 'A', 'C', 'H'};
+static constexpr uint32_t file_version = 1;
+static constexpr size_t header_size = sizeof(file_magic) + sizeof(file_version);
+static constexpr size_t record_header_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+/// @brief Size of a record for sudokus of an order
+static size_t record_size(size_t order)
+{
+    auto const n_cells = order * order * order * order;
+    return record_header_size + 2 * n_cells;
+}
+
+/// @brief FNV-1a hash of the order and cells of a canonical form
+static uint64_t hash_cells(size_t order, const std::vector<uint8_t>& cells)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = (hash ^ order) * 1099511628211ull;
+    for (auto const c : cells)
+        hash = (hash ^ c) * 1099511628211ull;
+    return hash;
+}
+
+/// @brief Write a whole buffer, retrying short writes
+static bool write_all(int fd, const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        auto const written = ::write(fd, data, size);
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+SolutionCache::SolutionCache(size_t capacity, const std::string& path)
+    : _capacity(std::max<size_t>(capacity, 1))
+{
+    if (!path.empty() && !open_file(path))
+    {
+        std::cerr << "Can't use " << path << " as cache file, keeping solutions in memory only" << std::endl;
+        if (_fd != -1)
+            ::close(_fd);
+        _fd = -1;
+    }
+}
+
+SolutionCache::~SolutionCache()
+{
+    if (_mapping != nullptr)
+        ::munmap(const_cast<uint8_t*>(_mapping), _mapped_size);
+    if (_fd != -1)
+        ::close(_fd);
+}
+
+bool SolutionCache::find(const Sudoku& sudoku, Sudoku& solution)
+{
+    canonicalize(sudoku);
+
+    Cells cells;
+    bool found = false;
+    auto const range = _index.equal_range(_hash);
+    for (auto it = range.first; it != range.second && !found; ++it)
+        if (it->second->puzzle == _puzzle)
+        {
+            // Most recently used goes first
+            _entries.splice(_entries.begin(), _entries, it->second);
+            cells = it->second->solution;
+            found = true;
+        }
+
+    if (!found && find_on_disk(cells))
+    {
+        remember(Entry{_hash, _puzzle, cells});
+        _disk_hits++;
+        found = true;
+    }
+
+    if (!found)
+    {
+        _misses++;
+        return false;
+    }
+
+    _hits++;
+    auto const n2 = static_cast<int>(_order * _order);
+    Sudoku canonical(_order);
+    for (int c = 0; c < n2 * n2; c++)
+        canonical.get_board().set(c / n2, c % n2, cells[c]);
+    solution = _transform.revert(canonical);
+    return true;
+}
+
+void SolutionCache::insert(const Sudoku& sudoku, const Sudoku& solution)
+{
+    canonicalize(sudoku);
+
+    auto const range = _index.equal_range(_hash);
+    for (auto it = range.first; it != range.second; ++it)
+        if (it->second->puzzle == _puzzle)
+            return;
+
+    auto const n2 = static_cast<int>(_order * _order);
+    auto const transformed = _transform.apply(solution);
+    Cells cells(n2 * n2);
+    for (int c = 0; c < n2 * n2; c++)
+        cells[c] = static_cast<uint8_t>(transformed.get_board().get(c / n2, c % n2));
+
+    // A record already on disk was dropped from memory, no need to write it again
+    Cells on_disk;
+    if (_fd != -1 && !find_on_disk(on_disk))
+    {
+        std::vector<uint8_t> record(record_size(_order));
+        auto const order = static_cast<uint32_t>(_order);
+        std::memcpy(record.data(), &_hash, sizeof(_hash));
+        std::memcpy(record.data() + sizeof(_hash), &order, sizeof(order));
+        std::memcpy(record.data() + record_header_size, _puzzle.data(), _puzzle.size());
+        std::memcpy(record.data() + record_header_size + _puzzle.size(), cells.data(), cells.size());
+        if (write_all(_fd, record.data(), record.size()))
+        {
+            _disk_index.emplace(_hash, _file_size);
+            _file_size += record.size();
+        }
+        else
+            std::cerr << "Can't write to cache file: " << std::strerror(errno) << std::endl;
+    }
+
+    remember(Entry{_hash, _puzzle, std::move(cells)});
+}
+
+void SolutionCache::canonicalize(const Sudoku& sudoku)
+{
+    auto const order = sudoku.get_order();
+    auto const n2 = static_cast<int>(order * order);
+    std::string board(n2 * n2, '\0');
+    for (int c = 0; c < n2 * n2; c++)
+        board[c] = static_cast<char>(sudoku.get_board().get(c / n2, c % n2));
+    // find then insert on the same sudoku is the usual sequence, and canonical forms aren't cheap
+    if (order == _order && board == _last_board)
+        return;
+
+    _transform = SudokuTransform::canonical(sudoku);
+    auto const canonical = _transform.apply(sudoku);
+    _puzzle.resize(n2 * n2);
+    for (int c = 0; c < n2 * n2; c++)
+        _puzzle[c] = static_cast<uint8_t>(canonical.get_board().get(c / n2, c % n2));
+    _hash = hash_cells(order, _puzzle);
+    _order = order;
+    _last_board = std::move(board);
+}
+
+bool SolutionCache::find_on_disk(Cells& solution)
+{
+    if (_fd == -1)
+        return false;
+
+    auto const range = _disk_index.equal_range(_hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        // Records appended since the file was mapped need a new mapping
+        if (it->second + record_size(_order) > _mapped_size && !remap())
+            return false;
+
+        auto const* record = _mapping + it->second;
+        uint32_t order;
+        std::memcpy(&order, record + sizeof(uint64_t), sizeof(order));
+        if (order != _order || std::memcmp(record + record_header_size, _puzzle.data(), _puzzle.size()) != 0)
+            continue;
+
+        auto const* cells = record + record_header_size + _puzzle.size();
+        solution.assign(cells, cells + _puzzle.size());
+        return true;
+    }
+
+    return false;
+}
+
+void SolutionCache::remember(Entry&& entry)
+{
+    auto const hash = entry.hash;
+    _entries.push_front(std::move(entry));
+    _index.emplace(hash, _entries.begin());
+
+    if (_entries.size() <= _capacity)
+        return;
+
+    auto const last = std::prev(_entries.end());
+    auto const range = _index.equal_range(last->hash);
+    for (auto it = range.first; it != range.second; ++it)
+        if (it->second == last)
+        {
+            _index.erase(it);
+            break;
+        }
+    _entries.pop_back();
+}
+
+bool SolutionCache::open_file(const std::string& path)
+{
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_fd == -1)
+        return false;
+
+    struct stat status;
+    if (::fstat(_fd, &status) != 0)
+        return false;
+    _file_size = static_cast<size_t>(status.st_size);
+
+    if (_file_size == 0)
+    {
+        uint8_t header[header_size];
+        std::memcpy(header, file_magic, sizeof(file_magic));
+        std::memcpy(header + sizeof(file_magic), &file_version, sizeof(file_version));
+        if (!write_all(_fd, header, header_size))
+            return false;
+        _file_size = header_size;
+    }
+
+    if (!remap())
+        return false;
+
+    uint32_t version;
+    if (_file_size < header_size || std::memcmp(_mapping, file_magic, sizeof(file_magic)) != 0)
+        return false;
+    std::memcpy(&version, _mapping + sizeof(file_magic), sizeof(version));
+    if (version != file_version)
+        return false;
+
+    // Index every complete record. A run killed while writing can leave a partial one at the end
+    size_t offset = header_size;
+    while (offset + record_header_size <= _file_size)
+    {
+        uint64_t hash;
+        uint32_t order;
+        std::memcpy(&hash, _mapping + offset, sizeof(hash));
+        std::memcpy(&order, _mapping + offset + sizeof(hash), sizeof(order));
+        if (order < 2 || order > 8 || offset + record_size(order) > _file_size)
+            break;
+        _disk_index.emplace(hash, offset);
+        offset += record_size(order);
+    }
+
+    if (offset != _file_size && ::ftruncate(_fd, static_cast<off_t>(offset)) != 0)
+        return false;
+    _file_size = offset;
+
+    return ::lseek(_fd, 0, SEEK_END) != -1;
+}
+
+bool SolutionCache::remap()
+{
+    if (_mapping != nullptr)
+        ::munmap(const_cast<uint8_t*>(_mapping), _mapped_size);
+    _mapping = nullptr;
+    _mapped_size = 0;
+
+    auto* mapping = ::mmap(nullptr, _file_size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    _mapping = static_cast<const uint8_t*>(mapping);
+    _mapped_size = _file_size;
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef SOLUTION_CACHE_HPP
+#define SOLUTION_CACHE_HPP
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Sudoku.hpp"
+#include "SudokuSymmetry.hpp"
+
+/// @brief Solutions of sudokus already solved, keyed by a hash of their canonical form, so symmetric copies of a
+/// sudoku share an entry. Recently used entries are kept in memory. Optionally, every entry is also appended to a
+/// file that is memory mapped when the cache is created, so later runs find what earlier ones solved
+class SolutionCache
+{
+    public:
+        /// @brief Create a cache, opening or creating its file if there's one
+        /// @param capacity max number of entries kept in memory, at least 1
+        /// @param path file for the on-disk store, empty to keep entries only in memory. If it can't be used,
+        /// a warning is printed and the cache works in memory only
+        SolutionCache(size_t capacity, const std::string& path = "");
+        ~SolutionCache();
+
+        SolutionCache(const SolutionCache&) = delete;
+        SolutionCache& operator=(const SolutionCache&) = delete;
+
+        /// @brief Look for a solution of a sudoku or of a symmetric copy of it
+        /// @param sudoku sudoku to look for, only its board is read
+        /// @param solution Output: the stored solution in the orientation of sudoku, if found
+        /// @return true if a solution was found
+        bool find(const Sudoku& sudoku, Sudoku& solution);
+
+        /// @brief Store the solution of a sudoku. Calling it right after find missed reuses its canonical form
+        /// @param sudoku sudoku that was solved
+        /// @param solution its solution, every cell filled
+        void insert(const Sudoku& sudoku, const Sudoku& solution);
+
+        /// @brief If entries are also written to a file
+        bool is_persistent() const { return _fd != -1; }
+
+        size_t get_hits() const { return _hits; }
+        size_t get_disk_hits() const { return _disk_hits; }
+        size_t get_misses() const { return _misses; }
+
+    private:
+        /// @brief Cells of a board in row major order, one byte each
+        using Cells = std::vector<uint8_t>;
+
+        struct Entry
+        {
+            uint64_t hash;
+            Cells puzzle;
+            Cells solution;
+        };
+
+        /// @brief Canonicalize a sudoku into _puzzle, _transform and _hash, unless it was the last one seen
+        void canonicalize(const Sudoku& sudoku);
+
+        /// @brief Look for _puzzle in the file
+        /// @param solution Output: solution cells of the record, if found
+        /// @return true if found
+        bool find_on_disk(Cells& solution);
+
+        /// @brief Put an entry at the front of the memory cache, dropping the least recently used one if full
+        void remember(Entry&& entry);
+
+        /// @brief Map the file and index its records, dropping a partial record left at its end
+        /// @return false if the file isn't a cache file
+        bool open_file(const std::string& path);
+
+        /// @brief Map the file again after records were appended
+        bool remap();
+
+    private:
+        size_t _capacity;
+        /// @brief Entries from most to least recently used
+        std::list<Entry> _entries;
+        std::unordered_multimap<uint64_t, std::list<Entry>::iterator> _index;
+
+        // On-disk store: file descriptor, -1 if there's none, its mapping and the offset of each record by hash
+        int _fd = -1;
+        const uint8_t* _mapping = nullptr;
+        size_t _mapped_size = 0;
+        size_t _file_size = 0;
+        std::unordered_multimap<uint64_t, size_t> _disk_index;
+
+        // Canonical form of the last sudoku seen
+        std::string _last_board;
+        Cells _puzzle;
+        SudokuTransform _transform;
+        uint64_t _hash = 0;
+        size_t _order = 0;
+
+        size_t _hits = 0;
+        size_t _disk_hits = 0;
+        size_t _misses = 0;
+};
+
+#endif
@@ -1,52 +1,287 @@
 #include <iostream>
 #include "Sudoku.hpp"
 #include "Array2D.hpp"
+#include "BaseCnf.hpp"
 #include <set>
+#include <sstream>
 #include <array>
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
 
 Sudoku::Sudoku(size_t n)
     : _board(Array2D<int>(n*n, n*n))
     , _order(n)
-{ }
+    , _candidates(Array2D<CandidateMask>(0, 0))
+{ 
+    assert(n * n <= 8 * sizeof(CandidateMask) && "Sudoku order too big for candidate masks");
+}
 
-SatSolver Sudoku::as_sat() const
+SatSolver Sudoku::as_sat(const EncodingOptions& options)
 {
-    std::vector<Clause> clauses;
+    SatSolver sat(0);
+    sat.set_n_variables(encode(sat, options));
+    return sat;
+}
 
-    add_completeness_clauses(clauses);
-    add_uniqueness_clauses(clauses);
-    add_validity_clauses(clauses);
+size_t Sudoku::encode(ClauseSink& sink, const EncodingOptions& options)
+{
+    // Cells filled here become givens, candidates of a propagated sudoku have to account for them
+    if (options.break_symmetries && fill_symmetric_cells() && _propagated)
+        propagate();
 
-    auto n = static_cast<int>(_order);
-    auto n2 = n * n; 
+    auto const n_variables = encode_rules(sink, options);
+    // A trivially unsatisfiable formula has nothing left to break
+    if (options.break_symmetries && _consistent && !(options.extended && has_missing_digit()))
+        add_symmetry_breaking_clauses(sink);
+    return n_variables;
+}
+
+size_t Sudoku::encode_rules(ClauseSink& sink, const EncodingOptions& options)
+{
+    set_dense(options.dense);
+    build_variable_map();
+
+    // Givens clash or some digit has nowhere to go: write a trivially unsatisfiable formula
+    if (!_consistent || (options.extended && has_missing_digit()))
+    {
+        sink.add_clause(Clause{1});
+        sink.add_clause(Clause{-1});
+        return 1;
+    }
+
+    if (options.dense)
+    {
+        encode_dense(sink, options);
+        return get_n_variables();
+    }
+
+    // Supported orders get an encoder with the order fixed at compile time
+    switch (_order)
+    {
+    case 2: return encode_order<2>(sink, options);
+    case 3: return encode_order<3>(sink, options);
+    case 4: return encode_order<4>(sink, options);
+    case 5: return encode_order<5>(sink, options);
+    case 6: return encode_order<6>(sink, options);
+    case 7: return encode_order<7>(sink, options);
+    case 8: return encode_order<8>(sink, options);
+    default: return encode_order<0>(sink, options);
+    }
+}
+
+template <int N>
+size_t Sudoku::encode_order(ClauseSink& sink, const EncodingOptions& options) const
+{
+    auto const n2 = fixed_order<N>() * fixed_order<N>();
+
+    // Split the work by rows and units. Each piece only reads the variable map, so they can run in any order.
+    // Regions come last in units. Lazy encodings add them as models break them, all different ones leave them to the propagator
+    auto const n_validity = options.lazy || options.all_different ? 0 : 3 * n2;
+    auto const n_tasks = static_cast<size_t>(2 * n2 + n_validity + (options.extended ? 3 * n2 : 0));
+    auto const task = [this, n2, n_validity, &options](size_t t, ClauseSink& sink, Variable& next_var)
+    {
+        auto const k = static_cast<int>(t);
+        if (k < n2)
+            add_completeness_clauses<N>(sink, k);
+        else if (k < 2 * n2)
+            add_uniqueness_clauses<N>(sink, k - n2, options.amo, next_var);
+        else if (k < 2 * n2 + n_validity)
+            for (int d = 1; d <= n2; d++)
+                add_validity_clauses<N>(sink, k - 2 * n2, d, k - 2 * n2 >= 2 * n2, options.amo, next_var);
+        else
+            add_at_least_once_clauses<N>(sink, k - 2 * n2 - n_validity);
+    };
+
+    // Auxiliary variables of at most one encodings go after the cell variables
+    auto const first_aux = static_cast<Variable>(get_n_variables()) + 1;
+    Variable next_var = first_aux;
+
+    auto threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    // Small sudokus encode in less time than it takes to start a thread
+    if (fixed_order<N>() < 4)
+        threads = 1;
+
+    if (threads == 1)
+        for (size_t t = 0; t < n_tasks; t++)
+            task(t, sink, next_var);
+    else 
+        run_encoding_tasks(n_tasks, task, sink, first_aux, next_var, threads);
+
+    return static_cast<size_t>(next_var - 1);
+}
+
+template <int N>
+int Sudoku::unit_cell(int u, int k) const
+{
+    auto const n = fixed_order<N>();
+    auto const n2 = n * n;
+    if (u < n2)
+        return u * n2 + k;
+    if (u < 2 * n2)
+        return k * n2 + u - n2;
+    auto const region = u - 2 * n2;
+    return ((region / n) * n + k / n) * n2 + (region % n) * n + k % n;
+}
+
+void Sudoku::find_free_digits(std::vector<int>& free_cells, std::vector<int>& free_digits) const
+{
+    auto const n = static_cast<int>(_order);
+    auto const n2 = n * n;
+
+    std::vector<bool> used(n2 + 1, false);
+    std::vector<int> box_givens(n2, 0);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+            if (auto const d = _board.get(i, j))
+            {
+                used[d] = true;
+                box_givens[(i / n) * n + j / n]++;
+            }
+
+    auto const box = static_cast<int>(std::min_element(box_givens.begin(), box_givens.end()) - box_givens.begin());
+    free_cells.clear();
+    free_digits.clear();
+    for (int k = 0; k < n2; k++)
+    {
+        auto const i = (box / n) * n + k / n, j = (box % n) * n + k % n;
+        if (_board.get(i, j) == 0)
+            free_cells.push_back(i * n2 + j);
+        if (!used[k + 1])
+            free_digits.push_back(k + 1);
+    }
+}
+
+bool Sudoku::fill_symmetric_cells()
+{
+    std::vector<int> free_cells, free_digits;
+    find_free_digits(free_cells, free_digits);
+    // Some digit given elsewhere goes in the box too, so free digits could take several sets of cells
+    if (free_digits.empty() || free_cells.size() != free_digits.size())
+        return false;
+
+    auto const n2 = static_cast<int>(_order * _order);
+    for (size_t k = 0; k < free_cells.size(); k++)
+        _board.set(free_cells[k] / n2, free_cells[k] % n2, free_digits[k]);
+    return true;
+}
+
+void Sudoku::add_symmetry_breaking_clauses(ClauseSink& sink) const
+{
+    auto const n2 = static_cast<int>(_order * _order);
+    std::vector<int> free_cells, free_digits;
+    find_free_digits(free_cells, free_digits);
 
-    return SatSolver(clauses, cell_to_variable(n2-1, n2-1, n2));
+    // Free digits go in increasing order along the free cells of the box, among other digits
+    for (size_t k = 0; k < free_cells.size(); k++)
+        for (size_t m = 0; m < free_digits.size(); m++)
+        {
+            auto const var = cell_to_variable(free_cells[k] / n2, free_cells[k] % n2, free_digits[m]);
+            if (var == 0)
+                continue;
+            // Free digits before m need cells before k, and free digits after m need cells after k
+            if (m > k || free_digits.size() - m > free_cells.size() - k)
+                sink.add_clause(Clause{-var});
+            // The next free digit can't be in a cell before k
+            for (size_t l = 0; m + 1 < free_digits.size() && l < k; l++)
+                if (auto const next = cell_to_variable(free_cells[l] / n2, free_cells[l] % n2, free_digits[m + 1]))
+                    sink.add_clause(Clause{-var, -next});
+        }
+}
+
+void Sudoku::run_encoding_tasks(size_t n_tasks, const EncodingTask& task, ClauseSink& sink, Variable first_aux, Variable& next_var, unsigned int threads)
+{
+    // Tasks run in batches, each one into its own buffer with auxiliary variables numbered from first_aux. 
+    // Buffers are then written in task order, shifting auxiliary variables past the ones already used, so
+    // output is the same as running tasks one after the other. Batches bound how many clauses are held at once
+    auto const batch_size = static_cast<size_t>(threads) * 4;
+    std::vector<ClauseBuffer> buffers(batch_size);
+    std::vector<Variable> aux_used(batch_size);
+
+    for (size_t batch_start = 0; batch_start < n_tasks; batch_start += batch_size)
+    {
+        auto const batch_end = std::min(batch_start + batch_size, n_tasks);
+        std::atomic<size_t> next_task(batch_start);
+
+        auto worker = [&]()
+        {
+            for (auto t = next_task++; t < batch_end; t = next_task++)
+            {
+                auto& buffer = buffers[t - batch_start];
+                buffer.clauses.clear();
+                Variable task_next_var = first_aux;
+                task(t, buffer, task_next_var);
+                aux_used[t - batch_start] = task_next_var - first_aux;
+            }
+        };
+
+        std::vector<std::future<void>> workers;
+        for (unsigned int w = 1; w < threads; w++)
+            workers.emplace_back(std::async(std::launch::async, worker));
+        worker();
+        for (auto& w : workers)
+            w.get();
+
+        for (size_t t = 0; t < batch_end - batch_start; t++)
+        {
+            auto const shift = next_var - first_aux;
+            for (auto& clause : buffers[t].clauses)
+            {
+                if (shift != 0)
+                    for (auto& var : clause)
+                        if (std::abs(var) >= first_aux)
+                            var += var > 0 ? shift : -shift;
+                sink.add_clause(clause);
+            }
+            next_var += aux_used[t];
+        }
+    }
 }
 
 Sudoku Sudoku::from_str(const std::string& sudoku_str)
 {
-    std::cout << "Not implemented" << std::endl;
-    return Sudoku(3);
+    std::stringstream ss(sudoku_str);
+    size_t order = 0;
+    ss >> order;
+    if (!ss || order < 2 || order * order > 8 * sizeof(CandidateMask))
+        return Sudoku(0);
+
+    Sudoku sudoku(order);
+    auto const n2 = order * order;
+    std::string next_num_str;
+    size_t num_index = 0;
+    while (std::getline(ss, next_num_str, '-'))
+    {
+        unsigned int next_num = 0;
+        if (num_index == n2 * n2 || sscanf(next_num_str.c_str(), "%u", &next_num) != 1 || next_num > n2)
+            return Sudoku(0);
+        sudoku._board.set(num_index / n2, num_index % n2, static_cast<int>(next_num));
+        num_index++;
+    }
+
+    return num_index == n2 * n2 ? sudoku : Sudoku(0);
 }
 
 void Sudoku::add_sat_solution(const SatSolution& sat_solution)
 {
-    // TODO check this function when a sat solver is ready
-    // Convert from number of variables to actual order
-
     // If can't solve sudoku, just return empty sudoku
     if (sat_solution.satisfiable == SatSatisfiable::UNKNOWN || sat_solution.satisfiable == SatSatisfiable::UNSATISFIABLE)
         return;
 
+    // Map might not be built yet if this sudoku was just parsed
+    if (_variable_cells.empty())
+        build_variable_map();
+
     // Fill 
     for(Variable variable : sat_solution.variable_states)
     {
         int i,j,d;
-        if (variable < 0) // false, we don't want it
+        // false, we don't want it. Variables outside the map are auxiliary 
+        if (variable < 0 || static_cast<size_t>(variable) > get_n_variables()) 
             continue;
 
-        variable_to_cell(abs(variable), i,j,d);
+        variable_to_cell(variable, i,j,d);
 
         if (_board.get(i,j) == 0)
             _board.set(i,j,d);
@@ -70,31 +305,354 @@ void Sudoku::display()
     }
 }
 
+std::string Sudoku::as_str() const
+{
+    std::string result = std::to_string(_order) + " ";
+    for(size_t i = 0; i < _board.get_rows(); i++)
+        for(size_t j = 0; j < _board.get_cols(); j++)
+        {
+            if (i != 0 || j != 0)
+                result += '-';
+            result += std::to_string(_board.get(i,j));
+        }
+
+    return result;
+}
+
 int Sudoku::cell_to_variable(int i, int j, int d) const
 {
     auto order = static_cast<int>(_order);
     auto n2 = order * order;
-    auto n4 = n2 * n2;
 
     assert(0 <= i && i < n2 && "invalid range for i");
     assert(0 <= j && j < n2 && "invalid range for j");
     assert(1 <= d && d <= n2 && "invalid range for d");
 
-    return n4 * i + n2 * j + d;
+    return _cell_variables[(i * n2 + j) * n2 + d - 1];
 }
 
 void Sudoku::variable_to_cell(Variable var, int& out_i, int& out_j, int& out_d) const
 {
-    var--;
     auto order = static_cast<int>(_order);
     auto n2 = order * order;
-    auto n4 = n2 * n2;
-    assert(0 <= var && var < n4*n2 && "Invalid range for variable");
+    assert(0 < var && static_cast<size_t>(var) < _variable_cells.size() && "Invalid range for variable");
+
+    auto const cell = _variable_cells[var];
+    out_d = cell % n2 + 1;
+    out_j = (cell / n2) % n2;
+    out_i = cell / (n2 * n2);
+}
+
+void Sudoku::build_variable_map()
+{
+    if (!_propagated)
+        _consistent = compute_candidates();
+
+    auto n2 = static_cast<int>(_order * _order);
+    _cell_variables.assign(n2 * n2 * n2, 0);
+    _variable_cells.assign(1, -1);
+    if (_dense)
+    {
+        for (int cell = 0; cell < n2 * n2 * n2; cell++)
+        {
+            _cell_variables[cell] = cell + 1;
+            _variable_cells.push_back(cell);
+        }
+        return;
+    }
+
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const candidates = _candidates.get(i, j);
+            for (int d = 1; d <= n2; d++)
+                if ((candidates >> (d - 1)) & 1)
+                {
+                    auto const cell = (i * n2 + j) * n2 + d - 1;
+                    _cell_variables[cell] = static_cast<Variable>(_variable_cells.size());
+                    _variable_cells.push_back(cell);
+                }
+        }
+}
+
+PropagationResult Sudoku::propagate()
+{
+    auto n = static_cast<int>(_order);
+    auto n2 = n * n;
+    _propagated = true;
+    _consistent = compute_candidates();
+    if (!_consistent)
+        return PropagationResult::CONTRADICTION;
+
+    auto const units = get_units();
+    // Units each cell belongs to: its row, column and region
+    auto units_of = [n, n2](int cell) { 
+        auto const i = cell / n2, j = cell % n2;
+        return std::array<int, 3>{i, n2 + j, 2 * n2 + (i / n) * n + j / n}; 
+    };
+
+    // Place digit d in cell, and remove it from candidates of every other cell in its units
+    auto place = [&](int cell, int d)
+    {
+        auto const digit = CandidateMask(1) << (d - 1);
+        _board.set(cell / n2, cell % n2, d);
+        _candidates.set(cell / n2, cell % n2, 0);
+        for (auto const unit : units_of(cell))
+            for (auto const other : units[unit])
+            {
+                auto const candidates = _candidates.get(other / n2, other % n2);
+                if (candidates & digit)
+                {
+                    _candidates.set(other / n2, other % n2, candidates & ~digit);
+                    if ((candidates & ~digit) == 0)
+                        _consistent = false;
+                }
+            }
+    };
+
+    // Remove digits from the candidates of an empty cell. A cell left with none has nowhere to go
+    auto remove = [&](int cell, CandidateMask digits)
+    {
+        auto const candidates = _candidates.get(cell / n2, cell % n2);
+        if ((candidates & digits) == 0)
+            return;
+        _candidates.set(cell / n2, cell % n2, candidates & ~digits);
+        if ((candidates & ~digits) == 0)
+            _consistent = false;
+    };
+
+    bool change = true;
+    while (change && _consistent)
+    {
+        change = false;
+
+        // Naked singles: cells with a single candidate
+        for (int cell = 0; cell < n2 * n2 && _consistent; cell++)
+        {
+            auto const candidates = _candidates.get(cell / n2, cell % n2);
+            if (candidates != 0 && (candidates & (candidates - 1)) == 0)
+            {
+                place(cell, __builtin_ctzll(candidates) + 1);
+                change = true;
+            }
+        }
+
+        // Hidden singles: digits with a single possible cell in some unit
+        for (size_t unit = 0; unit < units.size() && _consistent; unit++)
+        {
+            // Digits seen once, digits seen more than once, and digits already placed
+            CandidateMask once = 0, many = 0, placed = 0;
+            for (auto const cell : units[unit])
+            {
+                auto const candidates = _candidates.get(cell / n2, cell % n2);
+                many |= once & candidates;
+                once |= candidates;
+                if (auto const d = _board.get(cell / n2, cell % n2))
+                    placed |= CandidateMask(1) << (d - 1);
+            }
+            once &= ~many;
+
+            // A digit with nowhere to go
+            CandidateMask const all_digits = n2 == 8 * sizeof(CandidateMask) ? ~CandidateMask(0) : (CandidateMask(1) << n2) - 1;
+            if ((once | many | placed) != all_digits)
+            {
+                _consistent = false;
+                break;
+            }
+
+            for (auto const cell : units[unit])
+            {
+                auto const hidden = _candidates.get(cell / n2, cell % n2) & once;
+                if (hidden == 0)
+                    continue;
+                if ((hidden & (hidden - 1)) != 0) // Two digits that can only go in this cell
+                {
+                    _consistent = false;
+                    break;
+                }
+                place(cell, __builtin_ctzll(hidden) + 1);
+                change = true;
+            }
+        }
+
+        // Locked candidates: if inside a region a digit can only go in one row (or column), it can't go 
+        // anywhere else in that row (pointing). If inside a row (or column) a digit can only go in one region, 
+        // it can't go anywhere else in that region (claiming)
+        for (int region = 0; region < n2 && _consistent && !change; region++)
+            for (int line = 0; line < 2 * n2 && _consistent; line++)
+            {
+                auto const& region_cells = units[2 * n2 + region];
+                auto const& line_cells = units[line];
+                CandidateMask in_both = 0, only_region = 0, only_line = 0;
+                for (auto const cell : region_cells)
+                {
+                    auto const candidates = _candidates.get(cell / n2, cell % n2);
+                    if (std::find(line_cells.begin(), line_cells.end(), cell) != line_cells.end())
+                        in_both |= candidates;
+                    else
+                        only_region |= candidates;
+                }
+                if (in_both == 0)
+                    continue;
+                for (auto const cell : line_cells)
+                    if (std::find(region_cells.begin(), region_cells.end(), cell) == region_cells.end())
+                        only_line |= _candidates.get(cell / n2, cell % n2);
+
+                // Pointing removes from the line, claiming removes from the region
+                auto const pointing = in_both & ~only_region & only_line;
+                auto const claiming = in_both & ~only_line & only_region;
+                if (pointing == 0 && claiming == 0)
+                    continue;
+
+                for (auto const cell : line_cells)
+                    if (std::find(region_cells.begin(), region_cells.end(), cell) == region_cells.end())
+                        remove(cell, pointing);
+                for (auto const cell : region_cells)
+                    if (std::find(line_cells.begin(), line_cells.end(), cell) == line_cells.end())
+                        remove(cell, claiming);
+                change = true;
+            }
+    }
+
+    if (!_consistent)
+        return PropagationResult::CONTRADICTION;
+
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+            if (_board.get(i, j) == 0)
+                return PropagationResult::PARTIAL;
+
+    return PropagationResult::SOLVED;
+}
+
+std::string SudokuConflict::as_str() const
+{
+    std::stringstream ss;
+    ss << "cell (" << i + 1 << ", " << j + 1 << ")";
+    if (digit == 0)
+        ss << " has no candidates left";
+    else if (other_i < 0)
+        ss << " holds " << digit << ", which is out of range";
+    else 
+        ss << " and cell (" << other_i + 1 << ", " << other_j + 1 << ") both hold " << digit;
+    return ss.str();
+}
+
+std::vector<SudokuConflict> Sudoku::find_conflicts() const
+{
+    auto n = static_cast<int>(_order);
+    auto n2 = n * n;
+    std::vector<SudokuConflict> conflicts;
+
+    // Digits already used in each row, column and region, and which cell uses each of them
+    std::vector<CandidateMask> rows(n2, 0), cols(n2, 0), regions(n2, 0);
+    std::vector<int> row_owner(n2 * n2), col_owner(n2 * n2), region_owner(n2 * n2);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const d = _board.get(i, j);
+            if (d == 0)
+                continue;
+            if (d < 0 || d > n2)
+            {
+                conflicts.push_back(SudokuConflict{i, j, d});
+                continue;
+            }
+
+            auto const digit = CandidateMask(1) << (d - 1);
+            auto const region = (i / n) * n + j / n;
+            auto const index = d - 1;
+
+            // A clash in the same row and region is reported once
+            int owner = -1;
+            if (rows[i] & digit)
+                owner = i * n2 + row_owner[i * n2 + index];
+            else if (cols[j] & digit)
+                owner = col_owner[j * n2 + index] * n2 + j;
+            else if (regions[region] & digit)
+                owner = region_owner[region * n2 + index];
+
+            if (owner >= 0)
+                conflicts.push_back(SudokuConflict{i, j, d, owner / n2, owner % n2});
+
+            rows[i] |= digit;
+            cols[j] |= digit;
+            regions[region] |= digit;
+            row_owner[i * n2 + index] = j;
+            col_owner[j * n2 + index] = i;
+            region_owner[region * n2 + index] = i * n2 + j;
+        }
+
+    CandidateMask const all_digits = n2 == 8 * sizeof(CandidateMask) ? ~CandidateMask(0) : (CandidateMask(1) << n2) - 1;
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+            if (_board.get(i, j) == 0 && (all_digits & ~(rows[i] | cols[j] | regions[(i / n) * n + j / n])) == 0)
+                conflicts.push_back(SudokuConflict{i, j, 0});
+
+    return conflicts;
+}
+
+std::vector<std::vector<int>> Sudoku::get_units() const
+{
+    auto n = static_cast<int>(_order);
+    auto n2 = n * n;
+    std::vector<std::vector<int>> units(3 * n2);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const cell = i * n2 + j;
+            units[i].push_back(cell);
+            units[n2 + j].push_back(cell);
+            units[2 * n2 + (i / n) * n + j / n].push_back(cell);
+        }
+
+    return units;
+}
+
+bool Sudoku::compute_candidates()
+{
+    auto n = static_cast<int>(_order);
+    auto n2 = n * n;
+    CandidateMask const all_digits = n2 == 8 * sizeof(CandidateMask) ? ~CandidateMask(0) : (CandidateMask(1) << n2) - 1;
+    bool consistent = true;
+
+    // Digits already used in each row, column and region
+    std::vector<CandidateMask> rows(n2, 0), cols(n2, 0), regions(n2, 0);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const d = _board.get(i, j);
+            if (d == 0)
+                continue;
+            if (d < 0 || d > n2)
+            {
+                consistent = false;
+                continue;
+            }
+
+            auto const digit = CandidateMask(1) << (d - 1);
+            auto const region = (i / n) * n + j / n;
+            if ((rows[i] | cols[j] | regions[region]) & digit)
+                consistent = false;
+            rows[i] |= digit;
+            cols[j] |= digit;
+            regions[region] |= digit;
+        }
+
+    _candidates = Array2D<CandidateMask>(n2, n2);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            if (_board.get(i, j) != 0)
+                continue;
+
+            auto const candidates = all_digits & ~(rows[i] | cols[j] | regions[(i / n) * n + j / n]);
+            if (candidates == 0)
+                consistent = false;
+            _candidates.set(i, j, candidates);
+        }
 
-    out_d = var % n2;
-    out_j = ((var - out_d) / n2) % n2;
-    out_i = (var - out_d - n2 * out_j) / n4;
-    out_d++;
+    return consistent;
 }
 
 int  Sudoku::order_for_n_vars(int n_variables)
@@ -114,110 +672,309 @@ int  Sudoku::order_for_n_vars(int n_variables)
     }
 }
 
-void Sudoku::add_completeness_clauses(std::vector<Clause>& clauses) const
+template <int N>
+void Sudoku::add_completeness_clauses(ClauseSink& sink, int i) const
 {
-    auto order = static_cast<int>(_order);
-    auto n2 = order * order;
+    auto const n2 = fixed_order<N>() * fixed_order<N>();
     Clause next_clause;
-    for(int i = 0; i < n2; i++)
-        for(int j = 0; j < n2; j++)
+    for(int j = 0; j < n2; j++)
+    {
+        // Cells with a given have no variables, there's nothing to say about them
+        next_clause.clear();
+        for (int d = 1; d <= n2; d++)
+            if (auto const var = _cell_variables[(i * n2 + j) * n2 + d - 1])
+                next_clause.push_back(var);
+
+        if (!next_clause.empty())
+            sink.add_clause(next_clause);
+    }
+}
+
+template <int N>
+void Sudoku::add_uniqueness_clauses(ClauseSink& sink, int i, AmoEncoding amo, Variable& next_var) const
+{
+    auto const n2 = fixed_order<N>() * fixed_order<N>();
+    std::vector<Variable> group;
+    group.reserve(n2);
+    for (int j = 0; j < n2; j++)
+    {
+        group.clear();
+        for (int d = 1; d <= n2; d++)
+            if (auto const var = _cell_variables[(i * n2 + j) * n2 + d - 1])
+                group.push_back(var);
+
+        add_at_most_one(sink, group, amo, next_var);
+    }
+}
+
+template <int N>
+void Sudoku::add_validity_clauses(ClauseSink& sink, int u, int d, bool is_region, AmoEncoding amo, Variable& next_var) const
+{
+    auto const n2 = fixed_order<N>() * fixed_order<N>();
+    std::vector<Variable> group;
+    std::vector<int> group_cells;
+    group.reserve(n2);
+    group_cells.reserve(n2);
+
+    // Cells with a given in them are already accounted for by candidates
+    for (int k = 0; k < n2; k++)
+    {
+        auto const cell = unit_cell<N>(u, k);
+        if (auto const var = _cell_variables[cell * n2 + d - 1])
         {
-            for (int d = 1; d <= n2; d++)
+            group.push_back(var);
+            group_cells.push_back(cell);
+        }
+    }
+
+    // Pairwise, region pairs in the same row or column were already added by them
+    if (!is_region || amo_encoding_for(group.size(), amo) != AmoEncoding::PAIRWISE)
+    {
+        add_at_most_one(sink, group, amo, next_var);
+        return;
+    }
+
+    // One clause reused for every pair, sinks copy what they keep
+    Clause pair(2);
+    for (size_t a = 0; a < group.size(); a++)
+        for (size_t b = a + 1; b < group.size(); b++)
+            if (group_cells[a] / n2 != group_cells[b] / n2 && group_cells[a] % n2 != group_cells[b] % n2)
             {
-                // If this is already set in board, al this clause is trued, so it doesn't add to solution
-                if(_board.get(i,j) == d) 
-                {
-                    next_clause.clear(); // Don't add this clause
-                    break;
-                }
-                next_clause.push_back(cell_to_variable(i,j,d));
+                pair[0] = -group[a];
+                pair[1] = -group[b];
+                sink.add_clause(pair);
             }
-            if (!next_clause.empty())
+}
+
+size_t Sudoku::add_violated_clauses(const SatSolution& solution, ClauseSink& sink, const EncodingOptions& options, size_t& n_variables) const
+{
+    auto n2 = static_cast<int>(_order * _order);
+
+    // Digit in each cell according to the model, givens included
+    std::vector<int> digits(n2 * n2);
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+            digits[i * n2 + j] = _board.get(i, j);
+    for (auto const var : solution.variable_states)
+    {
+        if (var < 0 || static_cast<size_t>(var) > get_n_variables())
+            continue;
+        int i, j, d;
+        variable_to_cell(var, i, j, d);
+        digits[i * n2 + j] = d;
+    }
+
+    // Rows and columns of a region may not be encoded yet, so regions get their full group
+    auto next_var = static_cast<Variable>(n_variables) + 1;
+    size_t added = 0;
+    for (int u = 0; u < 3 * n2; u++)
+    {
+        CandidateMask seen = 0, repeated = 0;
+        for (int k = 0; k < n2; k++)
+            if (auto const d = digits[unit_cell<0>(u, k)])
             {
-                clauses.emplace_back(next_clause);
-                next_clause.clear();
+                auto const digit = CandidateMask(1) << (d - 1);
+                repeated |= seen & digit;
+                seen |= digit;
             }
+
+        for (; repeated != 0; repeated &= repeated - 1, added++)
+            add_validity_clauses<0>(sink, u, __builtin_ctzll(repeated) + 1, false, options.amo, next_var);
+    }
+
+    n_variables = static_cast<size_t>(next_var - 1);
+    return added;
+}
+
+template <int N>
+void Sudoku::add_at_least_once_clauses(ClauseSink& sink, int u) const
+{
+    auto const n2 = fixed_order<N>() * fixed_order<N>();
+    Clause next_clause;
+    for (int d = 1; d <= n2; d++)
+    {
+        // If d is already placed in this unit there's nothing to say. encode checked it has some candidate cell otherwise
+        next_clause.clear();
+        bool placed = false;
+        for (int k = 0; k < n2; k++)
+        {
+            auto const cell = unit_cell<N>(u, k);
+            placed |= _board.get(cell / n2, cell % n2) == d;
+            if (auto const var = _cell_variables[cell * n2 + d - 1])
+                next_clause.push_back(var);
         }
+
+        if (!placed)
+            sink.add_clause(next_clause);
+    }
 }
 
-void Sudoku::add_uniqueness_clauses(std::vector<Clause>& clauses) const
+void Sudoku::encode_dense(ClauseSink& sink, const EncodingOptions& options) const
 {
-    auto order = static_cast<int>(_order);
-    auto n2 = order * order;
+    switch (_order)
+    {
+    case 2:
+        sink.add_clauses(base_cnf_table<2>.data(), base_cnf_table<2>.size());
+        break;
+    case 3:
+        sink.add_clauses(base_cnf_table<3>.data(), base_cnf_table<3>.size());
+        break;
+    case 4:
+        sink.add_clauses(base_cnf_table<4>.data(), base_cnf_table<4>.size());
+        break;
+    default:
+    {
+        // Too big to bake into the binary, generate the same clauses now
+        Clause clause;
+        BaseCnf::generate(static_cast<int>(_order), [&sink, &clause](Variable literal)
+        {
+            if (literal != 0)
+            {
+                clause.push_back(literal);
+                return;
+            }
+            sink.add_clause(clause);
+            clause.clear();
+        });
+        break;
+    }
+    }
+
+    auto n2 = static_cast<int>(_order * _order);
     for (int i = 0; i < n2; i++)
         for (int j = 0; j < n2; j++)
-            for (int d = 1; d <= n2; d++)
-                for (int d_ = d+1; d_ <= n2; d_++)
-                {
-                    if (d == d_) continue;
-
-                    if (_board.get(i,j) == d && _board.get(i,j) == d_)
-                        return; // TODO kill entire thing, we have an inconsistent state
-                    else if (_board.get(i,j) == d) // If d is already in board, all depends on d_
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j,d_)});
-                    else if (_board.get(i,j) == d_) // If d_ is already in board, all depends on d
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j,d)});
+            if (auto const d = _board.get(i, j))
+                sink.add_clause(Clause{cell_to_variable(i, j, d)});
 
-                    // If we know nothing about any cell, add both
-                    clauses.emplace_back(Clause{-cell_to_variable(i,j,d), -cell_to_variable(i,j,d_)});
-                }
+    if (options.extended)
+        for (int u = 0; u < 3 * n2; u++)
+            add_at_least_once_clauses<0>(sink, u);
 }
 
-void  Sudoku::add_validity_clauses(std::vector<Clause>& clauses) const
+bool Sudoku::has_missing_digit() const
 {
-    auto n = static_cast<int>(_order);
-    auto n2 = n * n;
-    std::set<std::array<int, 4>> already_added_clauses;
+    auto n2 = static_cast<int>(_order * _order);
+    CandidateMask const all_digits = n2 == 8 * sizeof(CandidateMask) ? ~CandidateMask(0) : (CandidateMask(1) << n2) - 1;
+    for (auto const& unit : get_units())
+    {
+        CandidateMask available = 0;
+        for (auto const cell : unit)
+        {
+            auto const value = _board.get(cell / n2, cell % n2);
+            available |= value != 0 ? CandidateMask(1) << (value - 1) : _candidates.get(cell / n2, cell % n2);
+        }
 
-    // Iterate over rows 
-    for (int i = 0; i < n2; i++)
-        for(int j = 0; j < n2; j++)
-            for(int j_ = j+1; j_ < n2; j_++)
-                for(int d = 1; d <= n2; d++)
-                {
-                    if (_board.get(i,j) == d && _board.get(i,j_) == d)
-                        return; // TODO kill everything
-                    else if (_board.get(i,j) == d) // All depends on i,j_,d
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j_,d)});
-                    else if (_board.get(i,j_) == d) // All depends on i,j,d
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j,d)});
-                    else 
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j,d), -cell_to_variable(i,j_,d)});
-                }
+        if (available != all_digits)
+            return true;
+    }
 
-    // Iterate over cols 
-    for (int j = 0; j < n2; j++)
-        for(int i = 0; i < n2; i++)
-            for(int i_ = i+1; i_ < n2; i_++)
-                for(int d = 1; d <= n2; d++)
-                {
-                    if (_board.get(i,j) == d && _board.get(i_,j) == d)
-                        return; // TODO kill everything
-                    else if (_board.get(i,j) == d)
-                        clauses.emplace_back(Clause{-cell_to_variable(i_,j,d)});
-                    else if (_board.get(i_,j) == d)
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j,d)});
-                    else 
-                        clauses.emplace_back(Clause{-cell_to_variable(i,j,d), -cell_to_variable(i_,j,d)});
-                }
-                    
-    // Iterate over regions
-    for(int i = 0; i < n2; i += n)
-        for(int j = 0; j < n2; j += n)
-            for(int i_ = i; i_ < i + n; i_++)
-                for(int j_ = j; j_ < j + n; j_++)
-                    for(int i_2 = i_ + 1; i_2 < i + n; i_2 ++)
-                        for(int j_2 = j_ + 1; j_2 < j + n; j_2 ++)
-                            for(int d = 1; d <= n2; d++)
-                            {
-                                if (_board.get(i_, j_) == d && _board.get(i_2, j_2) == d)
-                                    return; // TODO kill everything
-                                else if (_board.get(i_, j_) == d)
-                                    clauses.emplace_back(Clause{-cell_to_variable(i_2, j_2, d)});
-                                else if (_board.get(i_2, j_2) == d)
-                                    clauses.emplace_back(Clause{-cell_to_variable(i_, j_, d)});
-                                else 
-                                    clauses.emplace_back(Clause{-cell_to_variable(i_, j_, d), -cell_to_variable(i_2, j_2, d)});
-                            }
+    return false;
+}
+
+AmoEncoding Sudoku::amo_encoding_for(size_t group_size, AmoEncoding amo)
+{
+    if (amo != AmoEncoding::AUTO)
+        return amo;
+
+    if (group_size <= 9)
+        return AmoEncoding::PAIRWISE;
+    if (group_size <= 32)
+        return AmoEncoding::SEQUENTIAL;
+    return AmoEncoding::PRODUCT;
 }
 
+void Sudoku::add_at_most_one(ClauseSink& sink, const std::vector<Variable>& vars, AmoEncoding amo, Variable& next_var)
+{
+    auto const k = vars.size();
+    if (k <= 1)
+        return;
+
+    amo = amo_encoding_for(k, amo);
+
+    // Below this size the recursive encodings cost more than the pairs they replace
+    if (k <= 4 && amo != AmoEncoding::SEQUENTIAL)
+        amo = AmoEncoding::PAIRWISE;
+
+    switch (amo)
+    {
+    case AmoEncoding::PAIRWISE:
+    {
+        // One clause reused for every pair, sinks copy what they keep
+        Clause pair(2);
+        for (size_t a = 0; a < k; a++)
+            for (size_t b = a + 1; b < k; b++)
+            {
+                pair[0] = -vars[a];
+                pair[1] = -vars[b];
+                sink.add_clause(pair);
+            }
+        break;
+    }
+
+    case AmoEncoding::SEQUENTIAL:
+    {
+        // s_i is true when some of vars[0..i] is true
+        Variable const s = next_var;
+        next_var += static_cast<Variable>(k - 1);
+        sink.add_clause(Clause{-vars[0], s});
+        for (size_t i = 1; i + 1 < k; i++)
+        {
+            auto const s_i = s + static_cast<Variable>(i);
+            sink.add_clause(Clause{-vars[i], s_i});
+            sink.add_clause(Clause{-(s_i - 1), s_i});
+            sink.add_clause(Clause{-vars[i], -(s_i - 1)});
+        }
+        sink.add_clause(Clause{-vars[k-1], -(s + static_cast<Variable>(k - 2))});
+        break;
+    }
+
+    case AmoEncoding::COMMANDER:
+    {
+        // Split in groups of 3, each with a commander that is true iff some variable in its group is
+        std::vector<Variable> commanders;
+        for (size_t start = 0; start < k; start += 3)
+        {
+            auto const end = std::min(start + 3, k);
+            auto const commander = next_var++;
+            commanders.push_back(commander);
+
+            Clause some_var{-commander};
+            for (size_t a = start; a < end; a++)
+            {
+                sink.add_clause(Clause{-vars[a], commander});
+                some_var.push_back(vars[a]);
+                for (size_t b = a + 1; b < end; b++)
+                    sink.add_clause(Clause{-vars[a], -vars[b]});
+            }
+            sink.add_clause(some_var);
+        }
+        add_at_most_one(sink, commanders, AmoEncoding::COMMANDER, next_var);
+        break;
+    }
+
+    case AmoEncoding::PRODUCT:
+    {
+        // Place variables in a p x q grid, a true variable selects its row and its column
+        size_t p = 1;
+        while (p * p < k) p++;
+        size_t const q = (k + p - 1) / p;
+
+        std::vector<Variable> rows, cols;
+        for (size_t r = 0; r < p; r++) rows.push_back(next_var++);
+        for (size_t c = 0; c < q; c++) cols.push_back(next_var++);
+
+        for (size_t a = 0; a < k; a++)
+        {
+            sink.add_clause(Clause{-vars[a], rows[a / q]});
+            sink.add_clause(Clause{-vars[a], cols[a % q]});
+        }
+        add_at_most_one(sink, rows, AmoEncoding::PRODUCT, next_var);
+        add_at_most_one(sink, cols, AmoEncoding::PRODUCT, next_var);
+        break;
+    }
+
+    case AmoEncoding::AUTO:
+        assert(false && "AUTO is resolved by amo_encoding_for");
+        break;
+    }
+}
@@ -7,22 +7,104 @@
 
 using Variable = int;
 using Clause = std::vector<Variable>;
+/// Set of digits, bit d-1 is set when digit d is in the set. Limits sudoku order to 8
+using CandidateMask = uint64_t;
 
 class SatSolution;
 class SatSolver;
 
+/// Outcome of sudoku level propagation
+enum PropagationResult
+{
+    /// Every cell was filled
+    SOLVED,
+    /// Some cells are still empty, the rest of the work goes to the SAT solver
+    PARTIAL,
+    /// Givens can't be completed into a valid sudoku
+    CONTRADICTION
+};
+
+/// A reason why the givens of a sudoku can't be completed
+struct SudokuConflict
+{
+    /// Cell with the problem
+    int i, j;
+    /// Digit given in (i, j), or 0 if (i, j) is empty and every digit is ruled out for it
+    int digit;
+    /// Cell in the same unit holding the same digit, -1 if the problem is only about (i, j)
+    int other_i = -1, other_j = -1;
+
+    /// @brief Human readable description, with rows and columns counted from 1
+    std::string as_str() const;
+};
+
+/// How to say that at most one variable of a group is true
+enum class AmoEncoding
+{
+    /// One binary clause per pair, k(k-1)/2 clauses and no auxiliary variables
+    PAIRWISE,
+    /// Sinz sequential counter, 3k - 4 clauses and k - 1 auxiliary variables
+    SEQUENTIAL,
+    /// Klieber-Kwon commander with groups of 3, about 3.5k clauses and k/2 auxiliary variables
+    COMMANDER,
+    /// Chen product encoding over a sqrt(k) x sqrt(k) grid, about 2k clauses and 2 sqrt(k) auxiliary variables
+    PRODUCT,
+    /// Pick one of the above for each group depending on its size
+    AUTO
+};
+
+/// Options for the sudoku to SAT encoding
+struct EncodingOptions
+{
+    /// @brief At most one encoding for cells and for each digit in rows, columns and regions
+    AmoEncoding amo = AmoEncoding::AUTO;
+
+    /// @brief Add redundant clauses saying each digit appears at least once in each row, column and region.
+    /// They let unit propagation find hidden singles
+    bool extended = false;
+    /// @brief Give every cell and digit a variable, (i * n^2 + j) * n^2 + d, and write givens as unit clauses. 
+    /// Rule clauses are then the same for every sudoku of an order, and for orders 2 to 4 they're copied from 
+    /// tables generated at compile time. Always pairwise, lazy and all_different are ignored
+    bool dense = false;
+    /// @brief Leave validity clauses out, to be added by Sudoku::add_violated_clauses as models break them.
+    /// Keeps formulas small, but isn't faster than the full encoding on its own
+    bool lazy = false;
+    /// @brief Leave validity clauses out too, and solve with a SudokuPropagator enforcing rows, columns and 
+    /// regions during search. Only for --solveSudoku, where it takes the place of lazy
+    bool all_different = false;
+    /// @brief Keep a single labeling of the digits no given uses, which can be swapped among themselves: they go
+    /// in increasing order along the box with fewest givens. When they are all that box is missing they are
+    /// written into it as givens, so an empty grid gets its first box fixed, else clauses keep the order. Models
+    /// still satisfy the givens, so they need no mapping back, but some solutions are left out, so it's no good 
+    /// for counting them
+    bool break_symmetries = false;
+    /// @brief Threads used to generate clauses for sudokus of order 4 or more, 0 to use one per core. 
+    /// Output doesn't depend on it
+    unsigned int threads = 0;
+};
+
 class Sudoku
 {
     public:
     Sudoku(size_t n);
 
-    /// @brief Convert this sudoku to a SAT Solver 
+    /// @brief Convert this sudoku to a SAT Solver. Only digits that are not ruled out by givens in the same
+    /// row, column or region get a variable. 
+    /// @param options options for the encoding 
     /// @return a SatSolver instance that mirrors this sudoku
-    SatSolver as_sat() const;
+    SatSolver as_sat(const EncodingOptions& options = EncodingOptions());
+
+    /// @brief Write the clauses of as_sat into a sink as they're generated, without storing them. 
+    /// Encoding twice gives the same clauses, so a ClauseCounter pass can be used to size a DIMACS header
+    /// @param sink destination for clauses
+    /// @param options options for the encoding 
+    /// @return number of variables used, including auxiliary ones
+    size_t encode(ClauseSink& sink, const EncodingOptions& options = EncodingOptions());
 
-    /// @brief Parse a sudoku from a string, as specified in the project document
+    /// @brief Parse a sudoku from a string, as specified in the project document: the order, a space, and the
+    /// digits in row major order separated by -. Same format as written by as_str
     /// @param sudoku_str string correctly formated as a sudoku str
-    /// @return Sudoku instance representing the given string
+    /// @return Sudoku instance representing the given string, a sudoku of order 0 if it's not valid
     static Sudoku from_str(const std::string& sudoku_str);
 
     /// @brief Create a sudoku from a sat solution, assuming the sat solution is consistent with a sudoku
@@ -33,51 +115,215 @@ class Sudoku
     /// @brief Get a reference to the board internal storage
     /// @return An Array2D with board information for this sudoku
     Array2D<int>& get_board() { return _board; }
+    const Array2D<int>& get_board() const { return _board; }
+
+    /// @brief Get order of this sudoku, the side of a region
+    size_t get_order() const { return _order; }
 
     /// @brief Print this sudoku in the terminal correctly formatted
     void display();
 
-    /// @brief Transform from board position and value to a variable number
+    /// @brief Single line representation in the input format of --solveSudoku: the order, a space, and the
+    /// digits in row major order separated by -, 0 for empty cells
+    std::string as_str() const;
+
+    /// @brief Transform from board position and value to a variable number. Requires the variable map to be built
     /// @param i position i in board
     /// @param j position d in board
     /// @param d value of position i,j in board
-    /// @return a number in range [0, n^6)
+    /// @return a number in range [1, get_n_variables()], or 0 if d is not a candidate for cell i,j
     int cell_to_variable(int i, int j, int d) const;
 
-    /// @brief Convert from a variable in range [0, n^6) to a valid board position and value
+    /// @brief Convert from a variable in range [1, get_n_variables()] to a valid board position and value. 
+    /// Requires the variable map to be built
     /// @param var variable to convert back to board position and value
     /// @param out_i position i in board
     /// @param out_j position j in board
     /// @param out_d value of position i,j
     void variable_to_cell(Variable var, int& out_i, int& out_j, int& out_d) const;
 
+    /// @brief Build the variable map used by as_sat and add_sat_solution from the current candidates, computing 
+    /// them from givens if propagate wasn't called. The map is a function of the board, so a sudoku parsed 
+    /// again from the same string and propagated the same way gets the same map
+    void build_variable_map();
+
+    /// @brief Choose between the compact variable map, with variables only for candidates, and the dense one, 
+    /// with a variable for every cell and digit. Takes effect on the next build_variable_map
+    /// @param dense if the dense map should be used
+    void set_dense(bool dense) { _dense = dense; }
+
+    /// @brief Run simple deductions on candidate bitmasks until nothing changes: naked singles, hidden singles 
+    /// and locked candidates (pointing and claiming). Forced cells are filled in the board, and eliminated 
+    /// candidates won't get a variable in as_sat
+    /// @return If the sudoku was solved, partially filled, or found to be inconsistent
+    PropagationResult propagate();
+
+    /// @brief Check a model of a lazy encoding against sudoku rules, and add validity clauses for every digit 
+    /// repeated in some row, column or region, so the next model can't repeat it there
+    /// @param solution model of the clauses written so far
+    /// @param sink destination for new clauses
+    /// @param options options used for the encoding 
+    /// @param n_variables number of variables used so far, updated with new auxiliary variables
+    /// @return number of (unit, digit) groups added, 0 if the model is a valid sudoku
+    size_t add_violated_clauses(const SatSolution& solution, ClauseSink& sink, const EncodingOptions& options, size_t& n_variables) const;
+
+    /// @brief Check givens with a bitmask pass over rows, columns and regions, without encoding anything
+    /// @return Every pair of clashing givens, given out of range and empty cell with no candidates. Empty if none
+    std::vector<SudokuConflict> find_conflicts() const;
+
+    /// @brief Get cells in each unit: rows first, then columns, then regions. Cells are indexed as i * n^2 + j
+    /// @return A list of n^2 cells for each of the 3 * n^2 units
+    std::vector<std::vector<int>> get_units() const;
+
     /// @brief Get order of sudoku based in number of variables
     /// @param n_variables number of variables
     /// @return order of this sudoku 
     static int  order_for_n_vars(int n_variables);
 
-    /// @brief Get the max number of variables for this sudoku
-    /// @return 
-    size_t get_n_variables() const { return _order * _order * _order * _order * _order * _order; }
+    /// @brief Get the number of variables for this sudoku, one per live candidate. Requires the variable map to be built
+    /// @return number of variables 
+    size_t get_n_variables() const { return _variable_cells.empty() ? 0 : _variable_cells.size() - 1; }
+
+    /// @brief If givens are consistent and every empty cell has some candidate, as found by the last 
+    /// build_variable_map or propagate
+    bool is_consistent() const { return _consistent; }
+
+    /// @brief Get candidates for each cell, computed by build_variable_map. Cells with a given have no candidates
+    /// @return An Array2D with a mask of candidate digits per cell
+    const Array2D<CandidateMask>& get_candidates() const { return _candidates; }
 
     private: 
-    /// @brief Add completeness clauses to the specified clauses set
-    /// @param clauses A vector that will be modified by adding new clauses
-    void add_completeness_clauses(std::vector<Clause>& clauses) const;
+    /// @brief Same as encode, without symmetry breaking
+    size_t encode_rules(ClauseSink& sink, const EncodingOptions& options);
+
+    /// @brief Write the rule clauses of the compact encoding. Requires the variable map to be built
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    /// @param sink destination for clauses
+    /// @param options options for the encoding
+    /// @return number of variables used, including auxiliary ones
+    template <int N>
+    size_t encode_order(ClauseSink& sink, const EncodingOptions& options) const;
+
+    /// @brief Order as seen by code templated on it. Orders 2 to 8 get their own instance, where this is a 
+    /// constant and index arithmetic in the encoding loops folds into shifts and multiplications
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    template <int N>
+    int fixed_order() const { return N != 0 ? N : static_cast<int>(_order); }
+
+    /// @brief Get cell at position k of unit u, with units numbered as in get_units
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    /// @param u unit: rows first, then columns, then regions
+    /// @param k position in the unit, cells are in row major order
+    /// @return cell as i * n^2 + j
+    template <int N>
+    int unit_cell(int u, int k) const;
+
+    /// @brief Find digits no given uses, which can be relabeled among themselves, and the empty cells of the
+    /// box with fewest givens, where the labeling is chosen
+    /// @param free_cells filled with empty cells of the box read by rows, as i * n^2 + j
+    /// @param free_digits filled with unused digits in increasing order
+    void find_free_digits(std::vector<int>& free_cells, std::vector<int>& free_digits) const;
+
+    /// @brief Fill the empty cells of the box with fewest givens with unused digits in order, if every other
+    /// digit is given in it. On an empty grid that fixes the first box
+    /// @return true if some cell was filled
+    bool fill_symmetric_cells();
 
-    /// @brief Add uniqueness clauses to the specified clauses set
-    /// @param clauses A vector that will be modified by adding new clauses
-    void add_uniqueness_clauses(std::vector<Clause>& clauses) const;
+    /// @brief Add clauses that keep unused digits in increasing order along the box with fewest givens, see
+    /// EncodingOptions::break_symmetries. Requires the variable map to be built
+    /// @param sink destination for new clauses
+    void add_symmetry_breaking_clauses(ClauseSink& sink) const;
 
-    /// @brief Add validity clauses to the specified clauses set
-    /// @param clauses A vector that will be modified by adding new clauses
-    void add_validity_clauses(std::vector<Clause>& clauses) const;
+    /// @brief Pieces of the encoding: task t writes its clauses to a sink, numbering auxiliary variables from next_var
+    using EncodingTask = std::function<void(size_t t, ClauseSink& sink, Variable& next_var)>;
 
-   
+    /// @brief Run encoding tasks on several threads, writing their clauses to sink in task order
+    /// @param n_tasks number of tasks to run
+    /// @param task function running each task
+    /// @param sink destination for clauses
+    /// @param first_aux first auxiliary variable, right after the cell variables
+    /// @param next_var next free variable for auxiliary variables, updated with the ones used
+    /// @param threads number of threads to use
+    static void run_encoding_tasks(size_t n_tasks, const EncodingTask& task, ClauseSink& sink, Variable first_aux, Variable& next_var, unsigned int threads);
+
+    /// @brief Add completeness clauses for a row to the specified clauses set
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    /// @param sink destination for new clauses
+    /// @param i row to encode
+    template <int N>
+    void add_completeness_clauses(ClauseSink& sink, int i) const;
+
+    /// @brief Add uniqueness clauses for cells in a row to the specified clauses set
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    /// @param sink destination for new clauses
+    /// @param i row to encode
+    /// @param amo at most one encoding to use
+    /// @param next_var next free variable for auxiliary variables, updated with the ones used
+    template <int N>
+    void add_uniqueness_clauses(ClauseSink& sink, int i, AmoEncoding amo, Variable& next_var) const;
+
+    /// @brief Add validity clauses for a single digit in a unit to the specified clauses set
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    /// @param sink destination for new clauses
+    /// @param u unit, numbered as in get_units
+    /// @param d digit to encode
+    /// @param is_region if unit is a region, whose pairs in the same row or column are covered by those units
+    /// @param amo at most one encoding to use
+    /// @param next_var next free variable for auxiliary variables, updated with the ones used
+    template <int N>
+    void add_validity_clauses(ClauseSink& sink, int u, int d, bool is_region, AmoEncoding amo, Variable& next_var) const;
+
+    /// @brief Add clauses saying at most one of the given variables is true
+    /// @param sink destination for new clauses
+    /// @param vars variables in the group
+    /// @param amo encoding to use, AUTO picks one from the group size
+    /// @param next_var next free variable for auxiliary variables, updated with the ones used
+    static void add_at_most_one(ClauseSink& sink, const std::vector<Variable>& vars, AmoEncoding amo, Variable& next_var);
+
+    /// @brief Choose the encoding for a group of the given size. Small groups are pairwise, since auxiliary
+    /// variables cost more than a few extra binary clauses, medium ones use the sequential counter which keeps 
+    /// propagation as strong as pairwise, and big ones the product encoding, which needs the fewest variables
+    /// @param group_size number of variables in the group
+    /// @param amo requested encoding
+    /// @return amo itself unless it's AUTO
+    static AmoEncoding amo_encoding_for(size_t group_size, AmoEncoding amo);
+
+    /// @brief Add redundant clauses saying each digit is somewhere in a unit
+    /// @tparam N order of this sudoku, or 0 if it's only known at run time
+    /// @param sink destination for new clauses
+    /// @param u unit, numbered as in get_units
+    template <int N>
+    void add_at_least_once_clauses(ClauseSink& sink, int u) const;
+
+    /// @brief Write the dense encoding: rule clauses for this order and a unit clause for each given
+    /// @param sink destination for new clauses
+    /// @param options options for the encoding, only extended is used
+    void encode_dense(ClauseSink& sink, const EncodingOptions& options) const;
+
+    /// @brief Check if some digit has no candidate cell in a unit where it's not placed yet
+    /// @return true if the at least once clause for that unit and digit would be empty
+    bool has_missing_digit() const;
+
+    /// @brief Compute candidates for each cell from givens in its row, column and region
+    /// @return false if givens clash or some empty cell has no candidates left
+    bool compute_candidates();
 
     private:
     Array2D<int> _board;
     size_t _order;
+
+    /// @brief Candidate digits per cell
+    Array2D<CandidateMask> _candidates;
+    /// @brief If givens are consistent and every empty cell has at least one candidate
+    bool _consistent = true;
+    /// @brief If every cell and digit gets a variable, instead of only candidates
+    bool _dense = false;
+    /// @brief If candidates were refined by propagate, so they shouldn't be computed again from givens
+    bool _propagated = false;
+    /// @brief Variable for each (i, j, d), indexed by (i * n^2 + j) * n^2 + d - 1. Zero if d is not a candidate
+    std::vector<Variable> _cell_variables;
+    /// @brief Index in _cell_variables for each variable. Variables start at 1, so first element is unused
+    std::vector<int> _variable_cells;
 };
 
 
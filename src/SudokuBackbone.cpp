@@ -0,0 +1,109 @@
+#include "SudokuBackbone.hpp"
+
+SudokuBackbone::SudokuBackbone(size_t order)
+    : _n2(static_cast<int>(order * order))
+    , _empty(order)
+    , _solver(SudokuPropagator::map_empty_grid(_empty))
+    , _propagator(_empty)
+    , _model(_n2 * _n2)
+{
+    // Assumptions change from call to call, so nothing can be eliminated for good
+    _solver.set_pure_literal_elimination(false);
+    _solver.set_propagator(&_propagator);
+    _solver.simplify();
+}
+
+BackboneResult SudokuBackbone::compute(const Sudoku& sudoku)
+{
+    BackboneResult result{SatSatisfiable::UNSATISFIABLE, Sudoku(sudoku.get_order()), 0};
+
+    // Clashing givens are found without a search. They'd also be out of range for the variable map
+    if (!sudoku.find_conflicts().empty())
+        return result;
+
+    // Cells deduced at sudoku level are fixed in every solution, so only the rest needs checking
+    auto& backbone = result.backbone.get_board();
+    Sudoku deduced(sudoku);
+    if (deduced.propagate() == PropagationResult::CONTRADICTION)
+        return result;
+
+    _assumptions.clear();
+    std::vector<int> open;
+    for (int c = 0; c < _n2 * _n2; c++)
+    {
+        auto const d = deduced.get_board().get(c / _n2, c % _n2);
+        backbone.set(c / _n2, c % _n2, d);
+        if (d != 0)
+            _assumptions.push_back(_empty.cell_to_variable(c / _n2, c % _n2, d));
+        else
+            open.push_back(c);
+    }
+
+    result.satisfiable = open.empty() ? SatSatisfiable::SATISFIABLE : solve();
+    if (result.satisfiable != SatSatisfiable::SATISFIABLE)
+        return result;
+
+    // Candidate digit of each open cell, 0 once some solution disagrees with it
+    auto candidates = _model;
+    for (auto const c : open)
+    {
+        auto const d = candidates[c];
+        if (d == 0 || backbone.get(c / _n2, c % _n2) != 0)
+            continue;
+
+        auto const var = _empty.cell_to_variable(c / _n2, c % _n2, d);
+        _assumptions.push_back(-var);
+        auto const satisfiable = solve();
+        _assumptions.pop_back();
+
+        if (satisfiable == SatSatisfiable::UNSATISFIABLE)
+        {
+            // Fixed, and every later check is a search with it given. With one more given, sudoku level 
+            // deductions often fix other cells too, on a unique sudoku usually all of them
+            backbone.set(c / _n2, c % _n2, d);
+            Sudoku more(result.backbone);
+            more.propagate();
+            for (auto const other : open)
+            {
+                auto const digit = more.get_board().get(other / _n2, other % _n2);
+                if (digit == 0 || backbone.get(other / _n2, other % _n2) != 0)
+                    continue;
+                backbone.set(other / _n2, other % _n2, digit);
+                _assumptions.push_back(_empty.cell_to_variable(other / _n2, other % _n2, digit));
+            }
+            _assumptions.push_back(var);
+            continue;
+        }
+
+        if (satisfiable == SatSatisfiable::UNKNOWN)
+        {
+            result.undecided++;
+            continue;
+        }
+
+        // The new solution rules out this candidate and any other it disagrees with
+        for (auto const other : open)
+            if (candidates[other] != _model[other])
+                candidates[other] = 0;
+    }
+
+    return result;
+}
+
+SatSatisfiable SudokuBackbone::solve()
+{
+    _solver_calls++;
+    auto const solution = _solver.solve(_assumptions);
+    if (solution.satisfiable != SatSatisfiable::SATISFIABLE)
+        return solution.satisfiable;
+
+    for (auto const var : solution.variable_states)
+    {
+        if (var <= 0)
+            continue;
+        int i, j, d;
+        _empty.variable_to_cell(var, i, j, d);
+        _model[i * _n2 + j] = d;
+    }
+    return SatSatisfiable::SATISFIABLE;
+}
@@ -0,0 +1,67 @@
+#ifndef SUDOKU_BACKBONE_HPP
+#define SUDOKU_BACKBONE_HPP
+#include <vector>
+#include "SatSolver.hpp"
+#include "Sudoku.hpp"
+#include "SudokuPropagator.hpp"
+
+/// @brief Backbone of a sudoku: the digit each cell takes in every solution
+struct BackboneResult
+{
+    /// SATISFIABLE if the givens have a solution, UNSATISFIABLE if they don't, UNKNOWN if the first search gave up
+    SatSatisfiable satisfiable;
+    /// Digit every solution has in each cell, givens included, 0 where solutions differ. Only if satisfiable
+    Sudoku backbone;
+    /// Cells whose check gave up on the decision limit, left at 0 in backbone though they may be fixed
+    size_t undecided;
+};
+
+/// @brief Finds the backbone of sudokus of an order, for hints or to see which givens are implied by the rest.
+/// Like SudokuSession, the solver is built once with a variable for every cell and digit of the empty grid and no
+/// clauses, a SudokuPropagator keeps one digit per cell and per unit, and givens are passed as assumptions. A first
+/// solution gives a candidate digit per cell. Each candidate is checked by solving with its negation: no solution
+/// proves it, and it's assumed from then on, while a solution rules out every candidate it disagrees with. Cells
+/// solved by sudoku level deductions need no check
+class SudokuBackbone
+{
+    public:
+        /// @brief Encode the empty grid of an order
+        /// @param order order of sudokus whose backbone is computed
+        explicit SudokuBackbone(size_t order);
+
+        // The solver keeps a pointer to _propagator
+        SudokuBackbone(const SudokuBackbone&) = delete;
+        SudokuBackbone& operator=(const SudokuBackbone&) = delete;
+
+        /// @brief Set maximum number of decisions of each search, 0 for no limit. Without learned clauses, proving
+        /// a cell fixed can take very long from order 4 on. A check that gives up leaves its cell out
+        void set_decision_limit(size_t limit) { _solver.set_decision_limit(limit); }
+
+        /// @brief Compute the backbone of a sudoku
+        /// @param sudoku sudoku of this order, its board holds the givens
+        /// @return backbone of the givens, or why it couldn't be found
+        BackboneResult compute(const Sudoku& sudoku);
+
+        /// @brief Get order of the sudokus this object takes
+        size_t get_order() const { return _empty.get_order(); }
+
+        /// @brief Get number of searches made since this object was created
+        size_t get_solver_calls() const { return _solver_calls; }
+
+    private:
+        /// @brief Solve the empty grid under _assumptions, writing a solution's digit of each cell to _model
+        SatSatisfiable solve();
+
+    private:
+        int _n2;
+        /// @brief Sudoku with no givens. Its variable map has a variable for every cell and digit
+        Sudoku _empty;
+        SatSolver _solver;
+        SudokuPropagator _propagator;
+        /// @brief Buffers reused between calls
+        std::vector<Variable> _assumptions;
+        std::vector<int> _model;
+        size_t _solver_calls = 0;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "SudokuGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <numeric>
+#include <thread>
+
+/// @brief Decisions allowed to each check, per cell of the grid
+static constexpr size_t decisions_per_cell = 4;
+
+SudokuGenerator::SudokuGenerator(size_t order)
+    : _n2(static_cast<int>(order * order))
+    , _n_cells(_n2 * _n2)
+    , _empty(order)
+    , _solver(_empty.as_sat(SudokuPropagator::empty_grid_encoding()))
+    , _propagator(_empty)
+{
+    // Assumptions change from call to call, so nothing can be eliminated for good
+    _solver.set_pure_literal_elimination(false);
+    _solver.set_propagator(&_propagator);
+    // Without learned clauses, proving that an emptied cell is forced can take forever from order 4 on. Such
+    // checks give up and the given stays, so sudokus keep a single solution but may not be minimal
+    _solver.set_decision_limit(decisions_per_cell * _n_cells);
+    _solver.simplify();
+}
+
+Sudoku SudokuGenerator::generate(unsigned int seed, size_t min_givens)
+{
+    std::mt19937 rng(seed);
+    std::vector<int> grid;
+    while (!fill_grid(rng, grid))
+        ;
+
+    // Take givens out in random order. The solution stays unique as long as the emptied cell can't hold any
+    // other digit, and cells that had to stay in are still needed once more cells are emptied
+    std::vector<int> cells(_n_cells);
+    std::iota(cells.begin(), cells.end(), 0);
+    std::shuffle(cells.begin(), cells.end(), rng);
+
+    Sudoku sudoku(_empty.get_order());
+    auto& board = sudoku.get_board();
+    for (int c = 0; c < _n_cells; c++)
+        board.set(c / _n2, c % _n2, grid[c]);
+
+    std::vector<bool> given(_n_cells, true);
+    auto n_givens = static_cast<size_t>(_n_cells);
+    for (auto const c : cells)
+    {
+        if (n_givens <= min_givens)
+            break;
+
+        // Most removals are undone by sudoku level deductions alone, which are much cheaper than a search
+        given[c] = false;
+        board.set(c / _n2, c % _n2, 0);
+        Sudoku deduced(sudoku);
+        if (deduced.propagate() == PropagationResult::SOLVED || solve(grid, given, c) == SatSatisfiable::UNSATISFIABLE)
+        {
+            n_givens--;
+            continue;
+        }
+
+        given[c] = true;
+        board.set(c / _n2, c % _n2, grid[c]);
+    }
+
+    return sudoku;
+}
+
+std::vector<Sudoku> SudokuGenerator::generate_batch(size_t order, size_t n_sudokus, unsigned int seed, size_t min_givens, unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, std::max<size_t>(n_sudokus, 1)));
+
+    std::vector<Sudoku> sudokus(n_sudokus, Sudoku(order));
+    std::atomic<size_t> next_sudoku(0);
+
+    auto worker = [&]()
+    {
+        SudokuGenerator generator(order);
+        for (auto k = next_sudoku++; k < n_sudokus; k = next_sudoku++)
+            sudokus[k] = generator.generate(seed + static_cast<unsigned int>(k), min_givens);
+    };
+
+    std::vector<std::future<void>> workers;
+    for (unsigned int w = 1; w < threads; w++)
+        workers.emplace_back(std::async(std::launch::async, worker));
+    worker();
+    for (auto& w : workers)
+        w.get();
+
+    return sudokus;
+}
+
+bool SudokuGenerator::fill_grid(std::mt19937& rng, std::vector<int>& grid)
+{
+    auto const order = static_cast<int>(_empty.get_order());
+    Sudoku sudoku(_empty.get_order());
+    auto& board = sudoku.get_board();
+
+    std::vector<int> digits(_n2);
+    std::iota(digits.begin(), digits.end(), 1);
+    for (int r = 0; r < order; r++)
+    {
+        std::shuffle(digits.begin(), digits.end(), rng);
+        for (int k = 0; k < _n2; k++)
+            board.set(r * order + k / order, r * order + k % order, digits[k]);
+    }
+
+    size_t guesses = 0;
+    if (!complete(rng, sudoku, guesses))
+        return false;
+
+    grid.resize(_n_cells);
+    for (int c = 0; c < _n_cells; c++)
+        grid[c] = board.get(c / _n2, c % _n2);
+    return true;
+}
+
+bool SudokuGenerator::complete(std::mt19937& rng, Sudoku& sudoku, size_t& guesses)
+{
+    auto const propagation = sudoku.propagate();
+    if (propagation != PropagationResult::PARTIAL)
+        return propagation == PropagationResult::SOLVED;
+
+    // Branch on the empty cell with fewest candidates
+    auto const& candidates = sudoku.get_candidates();
+    int best_cell = -1;
+    int best_count = _n2 + 1;
+    for (int c = 0; c < _n_cells; c++)
+    {
+        auto const count = __builtin_popcountll(candidates.get(c / _n2, c % _n2));
+        if (sudoku.get_board().get(c / _n2, c % _n2) == 0 && count < best_count)
+        {
+            best_cell = c;
+            best_count = count;
+        }
+    }
+
+    std::vector<int> digits;
+    for (int d = 1; d <= _n2; d++)
+        if (candidates.get(best_cell / _n2, best_cell % _n2) & (CandidateMask(1) << (d - 1)))
+            digits.push_back(d);
+    std::shuffle(digits.begin(), digits.end(), rng);
+
+    for (auto const d : digits)
+    {
+        // A bad start can take long to refute, drawing a new one is faster
+        if (++guesses > static_cast<size_t>(_n_cells))
+            return false;
+
+        Sudoku next(sudoku);
+        next.get_board().set(best_cell / _n2, best_cell % _n2, d);
+        if (complete(rng, next, guesses))
+        {
+            sudoku = next;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SatSatisfiable SudokuGenerator::solve(const std::vector<int>& grid, const std::vector<bool>& given, int excluded, std::vector<int>* solution)
+{
+    _assumptions.clear();
+    for (int c = 0; c < _n_cells; c++)
+        if (given[c])
+            _assumptions.push_back(_empty.cell_to_variable(c / _n2, c % _n2, grid[c]));
+    if (excluded != -1)
+        _assumptions.push_back(-_empty.cell_to_variable(excluded / _n2, excluded % _n2, grid[excluded]));
+
+    _solver_calls++;
+    auto const result = _solver.solve(_assumptions);
+    if (result.satisfiable != SatSatisfiable::SATISFIABLE)
+        return result.satisfiable;
+
+    if (solution != nullptr)
+        for (auto const var : result.variable_states)
+        {
+            if (var <= 0 || static_cast<size_t>(var) > _empty.get_n_variables())
+                continue;
+            int i, j, d;
+            _empty.variable_to_cell(var, i, j, d);
+            (*solution)[i * _n2 + j] = d;
+        }
+
+    return SatSatisfiable::SATISFIABLE;
+}
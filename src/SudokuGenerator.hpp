@@ -0,0 +1,80 @@
+#ifndef SUDOKU_GENERATOR_HPP
+#define SUDOKU_GENERATOR_HPP
+#include <random>
+#include <vector>
+#include "SatSolver.hpp"
+#include "Sudoku.hpp"
+#include "SudokuPropagator.hpp"
+
+/// @brief Generator of sudokus with a single solution. A random full grid is completed by the solver, then givens
+/// are taken out in random order, and each removal is kept only if no other digit fits the emptied cell. Every
+/// check runs on the same SatSolver, encoded once for the empty grid with rows, columns and regions left to a
+/// SudokuPropagator. Givens are passed as assumptions, so a check costs a search and nothing is encoded again
+class SudokuGenerator
+{
+    public:
+        /// @brief Encode the empty grid of an order
+        /// @param order order of generated sudokus, 2 to 8
+        explicit SudokuGenerator(size_t order);
+
+        // The solver keeps a pointer to _propagator
+        SudokuGenerator(const SudokuGenerator&) = delete;
+        SudokuGenerator& operator=(const SudokuGenerator&) = delete;
+
+        /// @brief Generate a sudoku with a single solution. The same seed gives the same sudoku
+        /// @param seed seed for every random choice
+        /// @param min_givens stop taking givens out when this many are left, 0 to take out as many as possible
+        /// @return a sudoku with givens only. No given can be removed from it, unless min_givens stopped it first
+        Sudoku generate(unsigned int seed, size_t min_givens = 0);
+
+        /// @brief Generate many sudokus over several threads, each one with its own generator. Sudoku k is
+        /// generated with seed + k, so output doesn't depend on the number of threads
+        /// @param order order of generated sudokus, 2 to 8
+        /// @param n_sudokus how many sudokus to generate
+        /// @param seed seed of the first sudoku
+        /// @param min_givens same as for generate
+        /// @param threads threads to use, 0 to use one per core
+        /// @return generated sudokus, in seed order
+        static std::vector<Sudoku> generate_batch(size_t order, size_t n_sudokus, unsigned int seed, size_t min_givens, unsigned int threads);
+
+        /// @brief Get number of solver calls made since this generator was created
+        size_t get_solver_calls() const { return _solver_calls; }
+
+    private:
+        /// @brief Fill a grid at random. Regions on the diagonal share no row or column, so random permutations
+        /// of the digits never clash there, and complete does the rest
+        /// @param rng source of random choices
+        /// @param grid Output: digit of each cell, in row major order
+        /// @return false if the diagonal couldn't be completed within the guess budget
+        bool fill_grid(std::mt19937& rng, std::vector<int>& grid);
+
+        /// @brief Complete a sudoku with sudoku level propagation and random guesses on the cell with fewest
+        /// candidates. Only fills grids: a SatSolver with a fixed variable order gets lost on empty grids of
+        /// order 4 and up, while deductions after each guess here fill most cells on their own
+        /// @param rng source of random choices
+        /// @param sudoku sudoku to complete, filled in place if it succeeds
+        /// @param guesses guesses made so far, gives up after one per cell
+        /// @return true if sudoku was completed
+        bool complete(std::mt19937& rng, Sudoku& sudoku, size_t& guesses);
+
+        /// @brief Solve the empty grid with some cells fixed
+        /// @param grid digit of each cell
+        /// @param given cells of grid to fix
+        /// @param excluded cell that must not hold its digit in grid, -1 for none
+        /// @param solution if not null, where to write the digit of each cell of the solution found
+        /// @return SATISFIABLE if there's a solution, UNSATISFIABLE if there's none
+        SatSatisfiable solve(const std::vector<int>& grid, const std::vector<bool>& given, int excluded, std::vector<int>* solution = nullptr);
+
+    private:
+        int _n2;
+        int _n_cells;
+        /// @brief Sudoku with no givens. Its variable map has a variable for every cell and digit
+        Sudoku _empty;
+        SatSolver _solver;
+        SudokuPropagator _propagator;
+        /// @brief Buffer for assumptions, reused between calls
+        std::vector<Variable> _assumptions;
+        size_t _solver_calls = 0;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "SudokuPropagator.hpp"
+#include "ClauseSink.hpp"
+
+EncodingOptions SudokuPropagator::empty_grid_encoding()
+{
+    EncodingOptions options;
+    options.all_different = true;
+    options.threads = 1;
+    return options;
+}
+
+size_t SudokuPropagator::map_empty_grid(Sudoku& empty)
+{
+    ClauseCounter counter;
+    empty.encode(counter, empty_grid_encoding());
+    return empty.get_n_variables();
+}
+
+SudokuPropagator::SudokuPropagator(const Sudoku& sudoku)
+    : _variable_groups(sudoku.get_n_variables() + 1)
+{
+    auto const n2 = static_cast<int>(sudoku.get_order() * sudoku.get_order());
+    auto const add_group = [this](std::vector<Variable>&& group) {
+        if (group.empty())
+            return;
+        for (auto const var : group)
+            _variable_groups[var].push_back(static_cast<int>(_groups.size()));
+        _groups.emplace_back(std::move(group));
+    };
+
+    // A digit per cell
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            std::vector<Variable> group;
+            for (int d = 1; d <= n2; d++)
+                if (auto const var = sudoku.cell_to_variable(i, j, d))
+                    group.push_back(var);
+            add_group(std::move(group));
+        }
+
+    // A cell per digit and unit. Digits already placed in a unit have no variables in it
+    for (auto const& unit : sudoku.get_units())
+        for (int d = 1; d <= n2; d++)
+        {
+            std::vector<Variable> group;
+            for (auto const cell : unit)
+                if (auto const var = sudoku.cell_to_variable(cell / n2, cell % n2, d))
+                    group.push_back(var);
+            add_group(std::move(group));
+        }
+}
+
+bool SudokuPropagator::propagate(const std::vector<int>& state, Variable literal, std::vector<Variable>& implied)
+{
+    auto const var = abs(literal);
+    if (static_cast<size_t>(var) >= _variable_groups.size())
+        return true;
+
+    for (auto const g : _variable_groups[var])
+    {
+        auto const& group = _groups[g];
+        if (literal > 0)
+        {
+            // Everything else in the group goes false
+            for (auto const other : group)
+            {
+                if (other == var || state[other] == 0)
+                    continue;
+                if (state[other] == 1)
+                    return false;
+                implied.push_back(-other);
+            }
+            continue;
+        }
+
+        // The group needs some variable that isn't false
+        Variable last_free = 0;
+        int n_free = 0;
+        bool satisfied = false;
+        for (auto const other : group)
+        {
+            satisfied |= state[other] == 1;
+            if (state[other] == -1)
+            {
+                last_free = other;
+                n_free++;
+            }
+        }
+
+        if (satisfied)
+            continue;
+        if (n_free == 0)
+            return false;
+        if (n_free == 1)
+            implied.push_back(last_free);
+    }
+
+    return true;
+}
+
+Clause SudokuPropagator::explain(const std::vector<int>& state, Variable literal)
+{
+    auto const var = abs(literal);
+    for (auto const g : _variable_groups[var])
+    {
+        auto const& group = _groups[g];
+        if (literal < 0)
+        {
+            // Some other variable of a shared group is true: at most one of both
+            for (auto const other : group)
+                if (other != var && state[other] == 1)
+                    return Clause{-var, -other};
+            continue;
+        }
+
+        // Every other variable of the group is false: at least one of them
+        bool others_false = true;
+        for (auto const other : group)
+            others_false &= other == var || state[other] == 0;
+        if (others_false)
+            return Clause(group.begin(), group.end());
+    }
+
+    return Clause();
+}
+
+Variable SudokuPropagator::decide(const std::vector<int>& state, const std::vector<int>& phase)
+{
+    // A phase is usually a solution of a similar sudoku. Placing its digits again, where they still fit, 
+    // rebuilds most of it without a search
+    if (!phase.empty())
+        for (size_t var = 1; var < _variable_groups.size(); var++)
+            if (state[var] == -1 && phase[var] == 1)
+                return static_cast<Variable>(var);
+
+    Variable best = 0;
+    int best_free = 0;
+    for (auto const& group : _groups)
+    {
+        Variable first_free = 0;
+        int n_free = 0;
+        bool satisfied = false;
+        for (auto const var : group)
+        {
+            satisfied |= state[var] == 1;
+            if (state[var] == -1)
+            {
+                first_free = first_free == 0 ? var : first_free;
+                n_free++;
+            }
+        }
+
+        if (satisfied || n_free == 0 || (best != 0 && n_free >= best_free))
+            continue;
+        best = first_free;
+        best_free = n_free;
+        // Single free variables are implied by propagate, two is as good as it gets
+        if (best_free <= 2)
+            break;
+    }
+
+    return best;
+}
@@ -0,0 +1,45 @@
+#ifndef SUDOKU_PROPAGATOR_HPP
+#define SUDOKU_PROPAGATOR_HPP
+#include <vector>
+#include "SatSolver.hpp"
+#include "Sudoku.hpp"
+
+/// @brief All different reasoning over a sudoku's variable map. Variables are split in groups where exactly one 
+/// is true: the digits of each cell, and the cells of each unit that can take each digit. A true variable makes
+/// the rest of its groups false, and a group with a single variable left that isn't false gets it true, which 
+/// covers hidden singles without at least once clauses. Enough to solve without validity clauses
+class SudokuPropagator : public SatPropagator
+{
+    public:
+        /// @brief Build groups from the variable map of a sudoku. Auxiliary variables take no part
+        /// @param sudoku sudoku whose variable map is already built, by encode or as_sat
+        explicit SudokuPropagator(const Sudoku& sudoku);
+
+        /// @brief Options for encoding the empty grid of solvers that take givens as assumptions: rows, columns
+        /// and regions are left to this propagator, so the formula is only completeness and uniqueness clauses,
+        /// small for every order, and a single thread writes them
+        static EncodingOptions empty_grid_encoding();
+
+        /// @brief Build the variable map of an empty grid, with a variable for every cell and digit, for solvers
+        /// with no clauses at all, where this propagator alone keeps one digit per cell and per unit
+        /// @param empty sudoku with no givens
+        /// @return number of variables for cells, auxiliary variables of the encoding are left out
+        static size_t map_empty_grid(Sudoku& empty);
+
+        bool propagate(const std::vector<int>& state, Variable literal, std::vector<Variable>& implied) override;
+
+        Clause explain(const std::vector<int>& state, Variable literal) override;
+
+        /// @brief Branch on the group with fewest options left, a cell with fewest candidates or a digit with 
+        /// fewest places in a unit, trying its first free variable true. With a phase, free variables it holds
+        /// true go first, in variable order
+        Variable decide(const std::vector<int>& state, const std::vector<int>& phase) override;
+
+    private:
+        /// @brief Variables of each group
+        std::vector<std::vector<Variable>> _groups;
+        /// @brief Groups each variable is in, indexed by variable
+        std::vector<std::vector<int>> _variable_groups;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "SudokuSession.hpp"
+
+/// @brief Decisions allowed to a search that follows the last solution, per cell of the grid
+static constexpr size_t hinted_decisions_per_cell = 2;
+
+SudokuSession::SudokuSession(const Sudoku& sudoku)
+    : _n2(static_cast<int>(sudoku.get_order() * sudoku.get_order()))
+    , _empty(sudoku.get_order())
+    , _givens(sudoku.get_order())
+    , _solver(SudokuPropagator::map_empty_grid(_empty))
+    , _propagator(_empty)
+    , _result{SatSatisfiable::UNKNOWN, Sudoku(sudoku.get_order()), {}, false}
+{
+    // Assumptions change from edit to edit, so nothing can be eliminated for good
+    _solver.set_pure_literal_elimination(false);
+    _solver.set_propagator(&_propagator);
+    _solver.simplify();
+    update(sudoku);
+}
+
+const SessionResult& SudokuSession::set(int i, int j, int digit)
+{
+    _givens.get_board().set(i, j, digit);
+    resolve({i * _n2 + j});
+    return _result;
+}
+
+const SessionResult& SudokuSession::update(const Sudoku& sudoku)
+{
+    std::vector<int> changed;
+    auto& givens = _givens.get_board();
+    for (int c = 0; c < _n2 * _n2; c++)
+    {
+        auto const d = sudoku.get_board().get(c / _n2, c % _n2);
+        if (d == givens.get(c / _n2, c % _n2))
+            continue;
+        givens.set(c / _n2, c % _n2, d);
+        changed.push_back(c);
+    }
+
+    // The first call has nothing to reuse, even if the grid is empty
+    if (_result.satisfiable == SatSatisfiable::UNKNOWN && changed.empty())
+        changed.push_back(0);
+    resolve(changed);
+    return _result;
+}
+
+void SudokuSession::resolve(const std::vector<int>& changed)
+{
+    auto const& givens = _givens.get_board();
+
+    // Clearing a cell can't break a solution, and neither can giving a cell the digit it already had
+    bool reuse = _result.satisfiable == SatSatisfiable::SATISFIABLE;
+    for (size_t k = 0; k < changed.size() && reuse; k++)
+    {
+        auto const d = givens.get(changed[k] / _n2, changed[k] % _n2);
+        reuse = d == 0 || d == _result.solution.get_board().get(changed[k] / _n2, changed[k] % _n2);
+    }
+    _result.reused = reuse;
+    if (reuse)
+        return;
+
+    // Clashing givens are found without a search. They'd also be out of range for the variable map
+    _result.conflicts = _givens.find_conflicts();
+    if (!_result.conflicts.empty())
+    {
+        _result.satisfiable = SatSatisfiable::UNSATISFIABLE;
+        return;
+    }
+
+    _assumptions.clear();
+    for (int c = 0; c < _n2 * _n2; c++)
+        if (givens.get(c / _n2, c % _n2) != 0)
+            _assumptions.push_back(_empty.cell_to_variable(c / _n2, c % _n2, givens.get(c / _n2, c % _n2)));
+
+    // _phase holds the last solution found, only cells that changed disagree with it. Following it blindly can
+    // lead far into a dead end, so it gets a few decisions per cell before a search that ignores it
+    SatSolution solution;
+    if (!_phase.empty())
+    {
+        _solver.set_phase(_phase);
+        _solver.set_decision_limit(hinted_decisions_per_cell * _n2 * _n2);
+        _solver_calls++;
+        solution = _solver.solve(_assumptions);
+    }
+    if (_phase.empty() || solution.satisfiable == SatSatisfiable::UNKNOWN)
+    {
+        _solver.set_phase(std::vector<int>());
+        _solver.set_decision_limit(0);
+        _solver_calls++;
+        solution = _solver.solve(_assumptions);
+    }
+    _result.satisfiable = solution.satisfiable;
+    if (solution.satisfiable != SatSatisfiable::SATISFIABLE)
+    {
+        for (auto it = changed.rbegin(); it != changed.rend(); ++it)
+        {
+            auto const d = givens.get(*it / _n2, *it % _n2);
+            if (d == 0)
+                continue;
+            _result.conflicts.push_back(SudokuConflict{*it / _n2, *it % _n2, d});
+            break;
+        }
+        return;
+    }
+
+    _phase.assign(solution.n_variables + 1, -1);
+    auto& board = _result.solution.get_board();
+    for (auto const var : solution.variable_states)
+    {
+        _phase[abs(var)] = var > 0 ? 1 : 0;
+        if (var < 0)
+            continue;
+        int i, j, d;
+        _empty.variable_to_cell(var, i, j, d);
+        board.set(i, j, d);
+    }
+}
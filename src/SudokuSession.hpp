@@ -0,0 +1,78 @@
+#ifndef SUDOKU_SESSION_HPP
+#define SUDOKU_SESSION_HPP
+#include <vector>
+#include "SatSolver.hpp"
+#include "Sudoku.hpp"
+#include "SudokuPropagator.hpp"
+
+/// @brief Outcome of an edit in a SudokuSession
+struct SessionResult
+{
+    /// SATISFIABLE if the givens have a solution, UNSATISFIABLE if they don't
+    SatSatisfiable satisfiable;
+    /// A solution of the givens, only if satisfiable
+    Sudoku solution;
+    /// Why there's no solution: givens that clash in a unit, or else the last cell set, which can't hold its digit
+    /// once the rest is filled. Empty if satisfiable
+    std::vector<SudokuConflict> conflicts;
+    /// If the previous solution still held and no search was needed
+    bool reused;
+};
+
+/// @brief A sudoku being edited, e.g. by an interactive frontend, solved again after every edit. The solver is
+/// built once with a variable for every cell and digit of the empty grid and no clauses at all: a SudokuPropagator
+/// keeps one digit per cell and per unit. Givens are passed as assumptions, so an edit costs a search and nothing 
+/// is encoded again. Clearing a cell, or setting it to the digit the last solution has there, keeps that solution.
+/// Any other edit searches with the last solution as phase, which is usually a few decisions away from a new one
+class SudokuSession
+{
+    public:
+        /// @brief Start a session on a sudoku and solve it
+        /// @param sudoku sudoku whose board holds the first givens
+        explicit SudokuSession(const Sudoku& sudoku);
+
+        // The solver keeps a pointer to _propagator
+        SudokuSession(const SudokuSession&) = delete;
+        SudokuSession& operator=(const SudokuSession&) = delete;
+
+        /// @brief Set or clear a cell and solve again
+        /// @param i row of the cell
+        /// @param j column of the cell
+        /// @param digit new given for the cell, 0 to clear it
+        /// @return solution of the new givens, or why there's none
+        const SessionResult& set(int i, int j, int digit);
+
+        /// @brief Take every given from a full grid, as a frontend sending the whole board would, and solve again
+        /// @param sudoku sudoku of the same order whose board holds the new givens
+        /// @return solution of the new givens, or why there's none
+        const SessionResult& update(const Sudoku& sudoku);
+
+        /// @brief Get outcome of the last edit
+        const SessionResult& get_result() const { return _result; }
+
+        /// @brief Get current givens
+        const Sudoku& get_givens() const { return _givens; }
+
+        /// @brief Get number of searches made. An edit whose search gave up on the last solution made two
+        size_t get_solver_calls() const { return _solver_calls; }
+
+    private:
+        /// @brief Solve the current givens, keeping the last solution if every changed cell agrees with it
+        /// @param changed cells changed since the last solution, as i * n^2 + j
+        void resolve(const std::vector<int>& changed);
+
+    private:
+        int _n2;
+        /// @brief Sudoku with no givens. Its variable map has a variable for every cell and digit
+        Sudoku _empty;
+        Sudoku _givens;
+        SatSolver _solver;
+        SudokuPropagator _propagator;
+        SessionResult _result;
+        /// @brief Buffers reused between edits
+        std::vector<Variable> _assumptions;
+        std::vector<int> _phase;
+        size_t _solver_calls = 0;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "SudokuSymmetry.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+    /// @brief A canonical form being built row by row, with its column order already chosen
+    struct PartialForm
+    {
+        int transpose;
+        /// @brief Index of its column order
+        int col_order;
+        /// @brief Rows of the transposed grid placed so far
+        std::vector<int> rows;
+        /// @brief Rows in rows, as a bit mask
+        uint64_t used;
+        /// @brief Band being filled, -1 between bands
+        int band;
+        /// @brief Label given to each digit so far, 0 if it didn't show up yet
+        std::vector<int> labels;
+        int next_label;
+
+        /// @brief What the remaining rows depend on. Forms that agree on it and on their rows so far end the same
+        auto key() const { return std::tie(transpose, col_order, used, band, labels); }
+    };
+
+    /// @brief Every column order that keeps stacks together, each one as the column that goes to each column.
+    /// Only the identity for orders above 3, which would have at least 24^5
+    std::vector<std::vector<int>> column_orders(int n)
+    {
+        auto const n2 = n * n;
+        std::vector<int> identity(n2);
+        std::iota(identity.begin(), identity.end(), 0);
+        if (n > 3)
+            return {identity};
+
+        std::vector<std::vector<int>> perms;
+        std::vector<int> perm(n);
+        std::iota(perm.begin(), perm.end(), 0);
+        do
+            perms.push_back(perm);
+        while (std::next_permutation(perm.begin(), perm.end()));
+
+        // A permutation for the stacks, and one for the columns of each stack, as digits of a mixed radix number
+        std::vector<std::vector<int>> orders;
+        for (auto const& stacks : perms)
+        {
+            std::vector<size_t> choice(n, 0);
+            while (true)
+            {
+                std::vector<int> order(n2);
+                for (int s = 0; s < n; s++)
+                    for (int k = 0; k < n; k++)
+                        order[s * n + k] = stacks[s] * n + perms[choice[s]][k];
+                orders.push_back(std::move(order));
+
+                int s = 0;
+                while (s < n && ++choice[s] == perms.size())
+                    choice[s++] = 0;
+                if (s == n)
+                    break;
+            }
+        }
+
+        return orders;
+    }
+}
+
+SudokuTransform SudokuTransform::identity(size_t order)
+{
+    auto const n2 = static_cast<int>(order * order);
+    SudokuTransform transform;
+    transform.rows.resize(n2);
+    transform.cols.resize(n2);
+    transform.digits.resize(n2 + 1);
+    std::iota(transform.rows.begin(), transform.rows.end(), 0);
+    std::iota(transform.cols.begin(), transform.cols.end(), 0);
+    std::iota(transform.digits.begin(), transform.digits.end(), 0);
+    return transform;
+}
+
+SudokuTransform SudokuTransform::canonical(const Sudoku& sudoku)
+{
+    auto const n = static_cast<int>(sudoku.get_order());
+    auto const n2 = n * n;
+    // The board and its transposition as flat arrays, this is the innermost loop
+    std::vector<int> grids[2] = {std::vector<int>(n2 * n2), std::vector<int>(n2 * n2)};
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+            grids[0][i * n2 + j] = grids[1][j * n2 + i] = sudoku.get_board().get(i, j);
+    // Empty cells sort after every digit, so rows with most givens go first, where they break the most ties
+    int const empty_key = n2 + 1;
+
+    // Build the form row by row keeping every partial form whose rows so far are the smallest seen. Rows
+    // only fit at the start of an unused band or in the band being filled
+    // Orders 2 and 3 have 8 and 1296 column orders, worth listing only once
+    static const std::vector<std::vector<int>> small_col_orders[2] = {column_orders(2), column_orders(3)};
+    auto const large_col_orders = n > 3 ? column_orders(n) : std::vector<std::vector<int>>();
+    auto const& col_orders = n > 3 ? large_col_orders : small_col_orders[n - 2];
+    std::vector<PartialForm> forms, next_forms;
+    // Transposing without column orders would mix rows and columns into something that isn't a group
+    for (int transpose = 0; transpose < (n > 3 ? 1 : 2); transpose++)
+        for (int c = 0; c < static_cast<int>(col_orders.size()); c++)
+            forms.push_back(PartialForm{transpose, c, {}, 0, -1, std::vector<int>(n2 + 1, 0), 1});
+
+    // Every form left has placed the same givens. Once all of them are placed the remaining rows are empty
+    // whichever way they're ordered, so there's nothing left to compare
+    auto const n_givens = static_cast<int>(std::count_if(grids[0].begin(), grids[0].end(), [](int d) { return d != 0; }));
+    int n_placed = 0;
+
+    std::vector<int> best_row(n2), row(n2), new_labels(n2 + 1);
+    for (int k = 0; k < n2 && n_placed < n_givens; k++)
+    {
+        next_forms.clear();
+        for (auto const& form : forms)
+        {
+            auto const& cols = col_orders[form.col_order];
+            int const first = form.band == -1 ? 0 : form.band * n;
+            int const last = form.band == -1 ? n2 : first + n;
+            for (int r = first; r < last; r++)
+            {
+                if ((form.used >> r) & 1)
+                    continue;
+
+                // Digits not labeled yet get the next labels in order of appearance. Stop as soon as the row
+                // reads bigger than the best one
+                std::fill(new_labels.begin(), new_labels.end(), 0);
+                int next_label = form.next_label;
+                int order = next_forms.empty() ? -1 : 0;
+                auto const* source = &grids[form.transpose][r * n2];
+                for (int j = 0; j < n2 && order <= 0; j++)
+                {
+                    auto const d = source[cols[j]];
+                    if (d != 0 && form.labels[d] == 0 && new_labels[d] == 0)
+                        new_labels[d] = next_label++;
+                    row[j] = d == 0 ? empty_key : form.labels[d] != 0 ? form.labels[d] : new_labels[d];
+                    if (order == 0 && row[j] != best_row[j])
+                        order = row[j] < best_row[j] ? -1 : 1;
+                }
+
+                if (order > 0)
+                    continue;
+                if (order < 0)
+                {
+                    next_forms.clear();
+                    best_row = row;
+                }
+
+                PartialForm next = form;
+                next.rows.push_back(r);
+                next.used |= uint64_t(1) << r;
+                next.band = k % n == n - 1 ? -1 : r / n;
+                for (int d = 1; d <= n2; d++)
+                    if (new_labels[d] != 0)
+                        next.labels[d] = new_labels[d];
+                next.next_label = next_label;
+                next_forms.push_back(std::move(next));
+            }
+        }
+
+        n_placed += static_cast<int>(std::count_if(best_row.begin(), best_row.end(), [empty_key](int d) { return d != empty_key; }));
+
+        // Forms reached through rows that look the same from here on can't end differently, keep one of each
+        std::sort(next_forms.begin(), next_forms.end(), [](const PartialForm& a, const PartialForm& b) { return a.key() < b.key(); });
+        next_forms.erase(std::unique(next_forms.begin(), next_forms.end(), [](const PartialForm& a, const PartialForm& b) { return a.key() == b.key(); }), next_forms.end());
+        std::swap(forms, next_forms);
+    }
+
+    // Every form left reads the same, so any of them will do. Digits that never showed up take the labels left
+    auto& form = forms.front();
+    while (static_cast<int>(form.rows.size()) < n2)
+    {
+        int r = form.band == -1 ? 0 : form.band * n;
+        while ((form.used >> r) & 1)
+            r++;
+        form.rows.push_back(r);
+        form.used |= uint64_t(1) << r;
+        form.band = form.rows.size() % n == 0 ? -1 : r / n;
+    }
+
+    SudokuTransform transform;
+    transform.transpose = form.transpose != 0;
+    transform.rows = form.rows;
+    transform.cols = col_orders[form.col_order];
+    transform.digits = form.labels;
+    for (int d = 1; d <= n2; d++)
+        if (transform.digits[d] == 0)
+            transform.digits[d] = form.next_label++;
+
+    return transform;
+}
+
+Sudoku SudokuTransform::apply(const Sudoku& sudoku) const
+{
+    auto const n2 = static_cast<int>(rows.size());
+    auto const& board = sudoku.get_board();
+    Sudoku result(sudoku.get_order());
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const d = transpose ? board.get(cols[j], rows[i]) : board.get(rows[i], cols[j]);
+            result.get_board().set(i, j, digits[d]);
+        }
+
+    return result;
+}
+
+Sudoku SudokuTransform::revert(const Sudoku& sudoku) const
+{
+    auto const n2 = static_cast<int>(rows.size());
+    std::vector<int> original_digits(digits.size());
+    for (size_t d = 0; d < digits.size(); d++)
+        original_digits[digits[d]] = static_cast<int>(d);
+
+    auto const& board = sudoku.get_board();
+    Sudoku result(sudoku.get_order());
+    for (int i = 0; i < n2; i++)
+        for (int j = 0; j < n2; j++)
+        {
+            auto const d = original_digits[board.get(i, j)];
+            if (transpose)
+                result.get_board().set(cols[j], rows[i], d);
+            else
+                result.get_board().set(rows[i], cols[j], d);
+        }
+
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef SUDOKU_SYMMETRY_HPP
+#define SUDOKU_SYMMETRY_HPP
+#include <vector>
+#include "Sudoku.hpp"
+
+/// @brief A symmetry of the sudoku grid: an optional transposition, then a permutation of rows and one of columns
+/// that keep bands and stacks together, and a relabeling of digits. Symmetries take sudokus to sudokus and
+/// solutions to solutions, so a solution of a transformed sudoku can be reverted into one of the original
+struct SudokuTransform
+{
+    /// @brief If the grid is transposed before moving rows and columns
+    bool transpose = false;
+    /// @brief Row of the transposed grid that goes to each row
+    std::vector<int> rows;
+    /// @brief Column of the transposed grid that goes to each column
+    std::vector<int> cols;
+    /// @brief New label of each digit, indexed by digit. Element 0 is 0, so empty cells stay empty
+    std::vector<int> digits;
+
+    /// @brief Transform that leaves sudokus of an order as they are
+    static SudokuTransform identity(size_t order);
+
+    /// @brief Transform that takes a sudoku to its canonical form: the smallest of its symmetric copies, read in
+    /// row major order with digits relabeled in order of first appearance and empty cells after every digit.
+    /// Symmetric copies of a sudoku get the same canonical form. For orders 2 and 3 that's every symmetry.
+    /// Larger orders have too many column orders to try, (n!)^(n+1), so columns stay in place and the grid 
+    /// isn't transposed: their forms are only shared by copies that differ in rows, bands and digits
+    /// @param sudoku sudoku to canonicalize, only its board is read
+    /// @return transform such that apply(sudoku) is the canonical form
+    static SudokuTransform canonical(const Sudoku& sudoku);
+
+    /// @brief Apply this transform to the board of a sudoku
+    /// @param sudoku sudoku of the order this transform was made for
+    /// @return a new sudoku with the transformed board
+    Sudoku apply(const Sudoku& sudoku) const;
+
+    /// @brief Undo this transform, e.g. to bring a solution of the canonical form back to the input's orientation
+    /// @param sudoku sudoku in the orientation apply leaves
+    /// @return a new sudoku with board s such that apply(s) is the board of sudoku
+    Sudoku revert(const Sudoku& sudoku) const;
+};
+
+#endif
@@ -12,6 +12,39 @@ int main(int argc, char** argv)
         std::cout<<"Valid options:\n\t--toSAT <sudoku> : where sudoku is a valid sudoku description\n";
         std::cout<<"\t--solve <cnf>: where cnf is a valid cnf SAT description\n";
         std::cout<<"\t--toSudoku <SAT>: where SAT is a valid SAT description\n";
+        std::cout<<"\t--estimate <cnf>: estimate search tree size and solving time for a cnf SAT description\n";
+        std::cout<<"\t--solveSudoku <file>: solve every sudoku in file, one per line\n";
+        std::cout<<"\t--canonical <file>: print the canonical form under symmetries of every sudoku in file\n";
+        std::cout<<"\t--solveBatch <file>: solve every order 3 sudoku in file with bitboards, printing solutions and throughput\n";
+        std::cout<<"\t--generate <n>: generate n sudokus with a single solution, one per line\n";
+        std::cout<<"\t--session <file>: solve each grid in file as an edit of the previous one, keeping the solver warm\n";
+        std::cout<<"\t--backbone <file>: print the cells every solution agrees on for every sudoku in file\n";
+        std::cout<<"Valid flags for --solve:\n\t--strategy=<watchlist|local|hybrid|lookahead> : search strategy, watchlist by default\n";
+        std::cout<<"\t--seed=<n> : seed for randomized strategies\n";
+        std::cout<<"\t--max-flips=<n> : flips a local or hybrid search makes before giving up, 1000000 by default\n";
+        std::cout<<"\t--mem-limit=<MB> : memory limit for the solver, answers unknown when exceeded\n";
+        std::cout<<"\t--stats[=json] : print solver statistics to stderr, human readable or as json\n";
+        std::cout<<"\t--progress=<n> : print statistics to stderr every n decisions\n";
+        std::cout<<"Valid flags for --toSAT, --toSudoku and --solveSudoku:\n\t--no-propagation : encode sudokus without propagating them first. Use it for both --toSAT and --toSudoku\n";
+        std::cout<<"\t--time=<s> : max seconds per sudoku for --solveSudoku, 0 to wait forever\n";
+        std::cout<<"\t--amo=<pairwise|sequential|commander|product|auto> : at most one encoding, auto picks by group size\n";
+        std::cout<<"\t--encode-threads=<n> : threads used to generate clauses for orders 4 and up, one per core by default\n";
+        std::cout<<"\t--backend=<sat|dlx|bitboard> : with --solveSudoku, solve through SAT, with dancing links exact cover or with order 3 bitboards\n";
+        std::cout<<"\t--dense : a variable for every cell and digit, rule clauses for orders 2 to 4 come precomputed\n";
+        std::cout<<"\t--lazy : with --solveSudoku, add validity clauses only when a model breaks them\n";
+        std::cout<<"\t--count[=<limit>] : with --solveSudoku, count solutions up to limit, 2 checks uniqueness\n";
+        std::cout<<"\t--cache[=<entries>] : with --solveSudoku, reuse solutions of sudokus seen before, also under symmetries. Keeps 1024 in memory by default\n";
+        std::cout<<"\t--cache-file=<file> : with --solveSudoku, also keep cached solutions in a file shared between runs. Implies --cache\n";
+        std::cout<<"\t--all-different : with --solveSudoku, solve with an all different propagator instead of validity clauses\n";
+        std::cout<<"\t--break-symmetries : keep one of each set of symmetric solutions, for sparse and empty grids. Ignored by --count\n";
+        std::cout<<"\t--extended : add redundant 'each digit at least once per row, column and region' clauses\n";
+        std::cout<<"Valid flags for --solveBatch:\n\t--verify : solve each sudoku again through SAT and compare\n";
+        std::cout<<"Valid flags for --generate:\n\t--order=<n> : order of generated sudokus, 2 to 8, 3 by default\n";
+        std::cout<<"\t--givens=<n> : stop removing givens when n are left, as few as possible by default\n";
+        std::cout<<"\t--threads=<n> : threads to use, one per core by default. Output doesn't depend on it\n";
+        std::cout<<"\t--seed=<n> : seed of the first sudoku, sudoku k uses seed + k\n";
+        std::cout<<"Valid flags for --estimate:\n\t--probes=<n> : number of random probes, 64 by default\n";
+        std::cout<<"\t--seed=<n>, --mem-limit=<MB> : same as for --solve\n";
         return 0;
     }
 
@@ -21,12 +54,40 @@ int main(int argc, char** argv)
     ForeGround call;
     call.init();
 
+    // --solveSudoku, --solveBatch, --canonical, --session and --backbone take a file before their flags, --generate a number of sudokus
+    int first_flag = option_string.compare("--solveSudoku") == 0 || option_string.compare("--solveBatch") == 0 
+                  || option_string.compare("--canonical") == 0 || option_string.compare("--generate") == 0
+                  || option_string.compare("--session") == 0 || option_string.compare("--backbone") == 0 ? 3 : 2;
+    if (first_flag > argc)
+    {
+        std::cerr<<"Missing argument for "<<option_string<<"\n";
+        return -1;
+    }
+
+    for (int i = first_flag; i < argc; i++)
+        if (call.parse_flag(argv[i]) == FAILURE)
+            return -1;
+
     if (option_string.compare("--toSAT") == 0) 
         result = call.sudoku_to_sat();
     else if (option_string.compare("--solve") == 0) 
         result = call.solver_caller();
     else if (option_string.compare("--toSudoku") == 0) 
         result = call.sat_to_sudoku();
+    else if (option_string.compare("--estimate") == 0) 
+        result = call.estimate_caller();
+    else if (option_string.compare("--solveSudoku") == 0) 
+        result = call.sudoku_file_caller(argv[2]);
+    else if (option_string.compare("--solveBatch") == 0) 
+        result = call.batch_caller(argv[2]);
+    else if (option_string.compare("--generate") == 0) 
+        result = call.generate_caller(argv[2]);
+    else if (option_string.compare("--canonical") == 0) 
+        result = call.canonical_caller(argv[2]);
+    else if (option_string.compare("--session") == 0) 
+        result = call.session_caller(argv[2]);
+    else if (option_string.compare("--backbone") == 0) 
+        result = call.backbone_caller(argv[2]);
     else  {
         std::cerr<<option_string<<" Is not a valid option of SatSolver\n";    
         return -1;